@@ -0,0 +1,99 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <tight_uint/tight_uint.hpp>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#endif
+
+namespace tight_uint {
+
+// Allocates with at least Alignment bytes alignment, e.g. 64 for a cache line
+// or the widest SIMD register, so bulk kernels start on an aligned word.
+template <class T, size_t Alignment = 64>
+class aligned_allocator {
+public:
+  using value_type = T;
+  static_assert(std::has_single_bit(Alignment) && Alignment >= alignof(T));
+
+  // Needed since allocator_traits cannot rebind a non-type parameter
+  template <class U>
+  struct rebind {
+    using other = aligned_allocator<U, Alignment>;
+  };
+
+  aligned_allocator() noexcept = default;
+  template <class U>
+  aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+  void deallocate(T* p, size_t n) noexcept {
+    ::operator delete(p, n * sizeof(T), std::align_val_t(Alignment));
+  }
+
+  friend bool operator==(const aligned_allocator&, const aligned_allocator&) {
+    return true;
+  }
+};
+
+// Large allocations are rounded up to and aligned to whole 2 MB pages and, on
+// Linux, marked for transparent huge pages. This cuts TLB misses when
+// randomly accessing big tables. Small allocations are cache line aligned.
+template <class T>
+class huge_page_allocator {
+public:
+  using value_type = T;
+  static constexpr size_t s_page_bytes  = size_t(2) << 20;
+  static constexpr size_t s_small_align = 64;
+
+  huge_page_allocator() noexcept = default;
+  template <class U>
+  huge_page_allocator(const huge_page_allocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < s_page_bytes)
+      return static_cast<T*>(
+          ::operator new(bytes, std::align_val_t(s_small_align)));
+    bytes = round_up(bytes);
+    void* p = ::operator new(bytes, std::align_val_t(s_page_bytes));
+#ifdef MADV_HUGEPAGE
+    // Only a hint. Failure leaves ordinary pages.
+    ::madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, size_t n) noexcept {
+    size_t bytes = n * sizeof(T);
+    if (bytes < s_page_bytes)
+      ::operator delete(p, bytes, std::align_val_t(s_small_align));
+    else
+      ::operator delete(p, round_up(bytes), std::align_val_t(s_page_bytes));
+  }
+
+  friend bool operator==(const huge_page_allocator&,
+                         const huge_page_allocator&) {
+    return true;
+  }
+
+private:
+  static size_t round_up(size_t bytes) {
+    return (bytes + s_page_bytes - 1) / s_page_bytes * s_page_bytes;
+  }
+};
+
+template <size_t bits, class T = uint32_t, size_t Alignment = 64>
+using aligned_vector = vector<bits, T, aligned_allocator<T, Alignment>>;
+
+template <size_t bits, class T = uint32_t>
+using huge_page_vector = vector<bits, T, huge_page_allocator<T>>;
+
+} // namespace tight_uint
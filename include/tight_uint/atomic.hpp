@@ -0,0 +1,99 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <atomic>
+#include <span>
+#include <tight_uint/tight_uint.hpp>
+
+namespace tight_uint {
+
+// Reference wrapper that updates only its own bits of the containing word(s)
+// with a compare-and-swap loop, so threads may write neighbouring values that
+// share a word without losing each other's updates.
+//
+// Guarantees, for values read and written through atomic_uint_value:
+// - Writes never modify the bits of any other value.
+// - A value contained in a single word is read and written atomically.
+// - A value that straddles two words is written as two atomic steps, the low
+//   word first, then the high word. Concurrent writes to the *same* straddling
+//   value, or a read racing with one, may observe a mix of the two halves.
+//   is_always_atomic is true when bits divides the word size, in which case
+//   no value straddles.
+template <class base_iterator, size_t bits>
+class atomic_uint_value {
+public:
+  using value_type = typename base_iterator::value_type;
+  atomic_uint_value()                               = delete;
+  atomic_uint_value(const atomic_uint_value& other) = delete;
+  atomic_uint_value(const base_iterator& value, uint8_t offset)
+      : m_value(value), m_offset(offset) {
+    static_assert(bits < s_type_bits);
+    static_assert(std::is_unsigned_v<value_type>,
+                  "signed types are not implemented");
+  }
+  const atomic_uint_value& operator=(const value_type& value) const {
+    const value_type masked_value = s_mask_bits() & value;
+    update(*m_value, static_cast<value_type>(s_mask_bits() << m_offset),
+           static_cast<value_type>(masked_value << m_offset));
+    if constexpr (!is_always_atomic) {
+      if (m_offset > s_type_bits - bits) {
+        uint8_t next_offset = s_type_bits - m_offset;
+        update(*(m_value + 1),
+               static_cast<value_type>(s_mask_bits() >> next_offset),
+               static_cast<value_type>(masked_value >> next_offset));
+      }
+    }
+    return *this;
+  }
+  operator value_type() const {
+    value_type result = static_cast<value_type>(load(*m_value) >> m_offset);
+    if constexpr (!is_always_atomic) {
+      if (m_offset > s_type_bits - bits) {
+        uint8_t next_offset = s_type_bits - m_offset;
+        result |= static_cast<value_type>(load(*(m_value + 1)) << next_offset);
+      }
+    }
+    return result & s_mask_bits();
+  }
+
+  atomic_uint_value& operator=(const atomic_uint_value& other) {
+    *this = static_cast<value_type>(other);
+    return *this;
+  }
+
+  static constexpr bool is_always_atomic = (sizeof(value_type) * 8) % bits == 0;
+
+protected:
+  static constexpr value_type s_mask_bits() {
+    return detail::mask_bits<bits, value_type>();
+  };
+  static constexpr uint8_t s_type_bits = sizeof(value_type) * 8;
+  base_iterator            m_value;
+  uint8_t                  m_offset;
+
+private:
+  static value_type load(value_type& word) {
+    return std::atomic_ref<value_type>(word).load(std::memory_order_acquire);
+  }
+  static void update(value_type& word, value_type mask, value_type value) {
+    std::atomic_ref<value_type> ref(word);
+    value_type expected = ref.load(std::memory_order_relaxed);
+    while (!ref.compare_exchange_weak(
+        expected, static_cast<value_type>((expected & ~mask) | value),
+        std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+// View of existing data that is safe to write from multiple threads. Words
+// must not be accessed non-atomically while shared.
+template <size_t bits, class T>
+using atomic_span = span<bits, T, atomic_uint_value>;
+
+template <size_t bits, class T, class Allocator>
+atomic_span<bits, T> make_atomic_span(vector<bits, T, Allocator>& container) {
+  return atomic_span<bits, T>(container);
+}
+
+} // namespace tight_uint
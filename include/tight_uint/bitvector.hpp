@@ -0,0 +1,346 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/cpu.hpp>
+#include <tight_uint/tight_uint.hpp>
+#include <utility>
+#include <vector>
+
+namespace tight_uint {
+
+// Iterates the indices of the set bits of a bitmap, skipping a whole word of
+// zeros at a time and finding each bit with countr_zero
+class set_bit_iterator {
+public:
+  using iterator_concept  = std::forward_iterator_tag;
+  using iterator_category = std::forward_iterator_tag;
+  using value_type        = size_t;
+  using difference_type   = std::ptrdiff_t;
+
+  set_bit_iterator() = default;
+  set_bit_iterator(const uint64_t* words, size_t word_count)
+      : m_words(words), m_word_count(word_count) {
+    if (m_word_count)
+      m_current = m_words[0];
+    skip_zeros();
+  }
+
+  size_t operator*() const {
+    return m_word * 64 + std::countr_zero(m_current);
+  }
+  set_bit_iterator& operator++() {
+    m_current &= m_current - 1;
+    skip_zeros();
+    return *this;
+  }
+  set_bit_iterator operator++(int) {
+    set_bit_iterator result = *this;
+    ++*this;
+    return result;
+  }
+
+  friend bool operator==(const set_bit_iterator& lhs,
+                         const set_bit_iterator& rhs) {
+    return lhs.m_word == rhs.m_word && lhs.m_current == rhs.m_current;
+  }
+  friend bool operator==(const set_bit_iterator& it, std::default_sentinel_t) {
+    return it.m_word >= it.m_word_count;
+  }
+
+private:
+  void skip_zeros() {
+    while (m_current == 0 && ++m_word < m_word_count)
+      m_current = m_words[m_word];
+  }
+
+  const uint64_t* m_words      = nullptr;
+  size_t          m_word_count = 0;
+  size_t          m_word       = 0;
+  uint64_t        m_current    = 0;
+};
+
+// A vector of bits with word-wide set operations. The storage is a
+// vector<1, uint64_t>, so it can be filled by scan_eq() and friends and
+// view() is a span like any other packed range. Bits past size() in the last
+// word are kept zero.
+class bitvector {
+public:
+  using storage_type = vector<1, uint64_t>;
+  using value_type   = bool;
+  using size_type    = size_t;
+
+  bitvector() = default;
+  explicit bitvector(size_type size, bool value = false)
+      : m_bits(size, uint64_t(value)) {}
+
+  // Takes ownership of packed bits, e.g. a selection bitmap from a scan
+  explicit bitvector(storage_type&& bits) : m_bits(std::move(bits)) {
+    clear_tail();
+  }
+
+  bool operator[](size_type index) const { return test(index); }
+  bool test(size_type index) const {
+    return (words()[index / 64] >> (index % 64)) & 1;
+  }
+  void set(size_type index, bool value = true) {
+    uint64_t  bit  = uint64_t(1) << (index % 64);
+    uint64_t& word = words()[index / 64];
+    word           = value ? word | bit : word & ~bit;
+  }
+  void reset(size_type index) { set(index, false); }
+  void flip(size_type index) {
+    words()[index / 64] ^= uint64_t(1) << (index % 64);
+  }
+
+  void resize(size_type size, bool value = false) {
+    size_type old_size = this->size();
+    m_bits.resize(size);
+    if (value && size > old_size)
+      tight_uint::fill(m_bits.begin() + old_size, m_bits.end(), uint64_t(1));
+  }
+  void push_back(bool value) {
+    m_bits.resize(size() + 1);
+    set(size() - 1, value);
+  }
+
+  bitvector& operator&=(const bitvector& other) {
+    return apply(other, [](uint64_t a, uint64_t b) { return a & b; });
+  }
+  bitvector& operator|=(const bitvector& other) {
+    return apply(other, [](uint64_t a, uint64_t b) { return a | b; });
+  }
+  bitvector& operator^=(const bitvector& other) {
+    return apply(other, [](uint64_t a, uint64_t b) { return a ^ b; });
+  }
+
+  // Clears the bits set in other, i.e. *this &= ~other without a copy
+  bitvector& and_not(const bitvector& other) {
+    return apply(other, [](uint64_t a, uint64_t b) { return a & ~b; });
+  }
+
+  // Inverts every bit
+  bitvector& flip() {
+    for (uint64_t& word : words())
+      word = ~word;
+    clear_tail();
+    return *this;
+  }
+
+  friend bitvector operator&(bitvector lhs, const bitvector& rhs) {
+    return std::move(lhs &= rhs);
+  }
+  friend bitvector operator|(bitvector lhs, const bitvector& rhs) {
+    return std::move(lhs |= rhs);
+  }
+  friend bitvector operator^(bitvector lhs, const bitvector& rhs) {
+    return std::move(lhs ^= rhs);
+  }
+  friend bitvector operator~(bitvector bits) { return std::move(bits.flip()); }
+  friend bool      operator==(const bitvector& lhs, const bitvector& rhs) {
+    return lhs.m_bits == rhs.m_bits;
+  }
+
+  // Number of set bits
+  size_type count() const {
+    size_type result = 0;
+    for (uint64_t word : words())
+      result += std::popcount(word);
+    return result;
+  }
+  bool any() const {
+    return std::ranges::any_of(words(), [](uint64_t w) { return w != 0; });
+  }
+  bool none() const { return !any(); }
+
+  // Index of the first set bit, or size() if none
+  size_type find_first() const { return find_from(0); }
+
+  // Index of the first set bit after index, or size() if none
+  size_type find_next(size_type index) const { return find_from(index + 1); }
+
+  // The indices of the set bits, in order
+  auto set_bits() const {
+    return std::ranges::subrange(
+        set_bit_iterator(words().data(), words().size()),
+        std::default_sentinel);
+  }
+
+  size_type size() const { return m_bits.size(); }
+  bool      empty() const { return size() == 0; }
+
+  std::span<uint64_t> words() {
+    return {reinterpret_cast<uint64_t*>(m_bits.data()),
+            m_bits.size_bytes() / sizeof(uint64_t)};
+  }
+  std::span<const uint64_t> words() const {
+    return {reinterpret_cast<const uint64_t*>(m_bits.data()),
+            m_bits.size_bytes() / sizeof(uint64_t)};
+  }
+
+  span<1, uint64_t>       view() { return m_bits; }
+  span<1, const uint64_t> view() const { return m_bits; }
+  storage_type&           storage() { return m_bits; }
+  const storage_type&     storage() const { return m_bits; }
+
+private:
+  template <class Op>
+  bitvector& apply(const bitvector& other, Op op) {
+    if (other.size() != size())
+      throw std::invalid_argument("bitvector sizes differ");
+    std::span<uint64_t>       lhs = words();
+    std::span<const uint64_t> rhs = other.words();
+    for (size_t i = 0; i < lhs.size(); ++i)
+      lhs[i] = op(lhs[i], rhs[i]);
+    return *this;
+  }
+
+  size_type find_from(size_type index) const {
+    if (index >= size())
+      return size();
+    std::span<const uint64_t> w    = words();
+    size_t                    i    = index / 64;
+    uint64_t                  word = w[i] & (~uint64_t(0) << (index % 64));
+    while (word == 0) {
+      if (++i == w.size())
+        return size();
+      word = w[i];
+    }
+    return i * 64 + std::countr_zero(word);
+  }
+
+  void clear_tail() {
+    if (size() % 64)
+      words().back() &= (uint64_t(1) << (size() % 64)) - 1;
+  }
+
+  storage_type m_bits;
+};
+
+// Constant time rank and fast select over a bitmap, in the rank9 layout: each
+// 512 bit block stores the number of ones before it and, packed into a second
+// word, seven 9 bit counts of the ones before each of its words. That is 25%
+// extra space. Every 512th one also records its block, bounding the binary
+// search in select().
+//
+// The index refers to the bits, which must outlive it. Rebuild the index
+// after modifying them. Bits past size() are ignored.
+class rank_select {
+public:
+  rank_select() = default;
+  explicit rank_select(span<1, const uint64_t> bits)
+      : m_words(std::to_address(bits.begin().base())),
+        m_size(bits.size()),
+        m_counts(2 * (bits.size() / 512 + 1)) {
+    uint64_t ones = 0;
+    for (size_t block = 0; block < m_counts.size() / 2; ++block) {
+      m_counts[2 * block] = ones;
+      uint64_t sub        = 0;
+      for (size_t w = 0; w < 8; ++w) {
+        if (w > 0)
+          sub |= (ones - m_counts[2 * block]) << (9 * (w - 1));
+        size_t word = block * 8 + w;
+        if (word * 64 >= m_size)
+          continue;
+        // Record the block of each one numbered a multiple of 512
+        size_t word_ones = popcount_word(word);
+        while (m_samples.size() * 512 < ones + word_ones)
+          m_samples.push_back(block);
+        ones += word_ones;
+      }
+      m_counts[2 * block + 1] = sub;
+    }
+    m_ones = ones;
+  }
+  explicit rank_select(const bitvector& bits) : rank_select(bits.view()) {}
+
+  // Number of ones in [0, index), for index <= size()
+  size_t rank1(size_t index) const {
+    // Word 0 of a block shifts to the always zero top bit
+    size_t   block  = index / 512;
+    size_t   w      = index / 64 % 8;
+    uint64_t sub    = m_counts[2 * block + 1] >> (9 * ((w + 7) % 8));
+    size_t   result = m_counts[2 * block] + (sub & 0x1ff);
+    if (index % 64)
+      result += std::popcount(m_words[index / 64] &
+                              ((uint64_t(1) << index % 64) - 1));
+    return result;
+  }
+
+  // Number of zeros in [0, index)
+  size_t rank0(size_t index) const { return index - rank1(index); }
+
+  // Index of the one numbered k, counting from zero, for k < count()
+  size_t select1(size_t k) const {
+    // The last block whose count of preceding ones is at most k
+    size_t first = m_samples[k / 512];
+    size_t last  = k / 512 + 1 < m_samples.size() ? m_samples[k / 512 + 1] + 1
+                                                  : m_counts.size() / 2;
+    while (last - first > 1) {
+      size_t middle = (first + last) / 2;
+      if (m_counts[2 * middle] <= k)
+        first = middle;
+      else
+        last = middle;
+    }
+    size_t   rest = k - m_counts[2 * first];
+    uint64_t sub  = m_counts[2 * first + 1];
+    size_t   w    = 0;
+    while (w < 7 && ((sub >> (9 * w)) & 0x1ff) <= rest)
+      ++w;
+    if (w > 0)
+      rest -= (sub >> (9 * (w - 1))) & 0x1ff;
+    size_t word = first * 8 + w;
+    return word * 64 + select_in_word(m_words[word], rest);
+  }
+
+  size_t count() const { return m_ones; }
+  size_t size() const { return m_size; }
+
+private:
+  // Ones of a word, ignoring any bits past size()
+  size_t popcount_word(size_t word) const {
+    uint64_t bits = m_words[word];
+    if ((word + 1) * 64 > m_size)
+      bits &= (uint64_t(1) << m_size % 64) - 1;
+    return std::popcount(bits);
+  }
+
+#if defined(TIGHT_UINT_BMI2)
+  // pdep deposits a single one onto the set bit numbered rank
+  TIGHT_UINT_TARGET("bmi2")
+  static size_t select_in_word_bmi2(uint64_t word, size_t rank) {
+    return std::countr_zero(_pdep_u64(uint64_t(1) << rank, word));
+  }
+#endif
+
+  // Index of the set bit numbered rank in word, a byte at a time
+  static size_t select_in_word(uint64_t word, size_t rank) {
+#if defined(TIGHT_UINT_BMI2)
+    if (cpu().bmi2)
+      return select_in_word_bmi2(word, rank);
+#endif
+    size_t shift = 0;
+    for (size_t ones; (ones = std::popcount(word >> shift & 0xff)) <= rank;
+         shift += 8)
+      rank -= ones;
+    word >>= shift;
+    for (; rank; --rank)
+      word &= word - 1;
+    return shift + std::countr_zero(word);
+  }
+
+  const uint64_t*       m_words = nullptr;
+  size_t                m_size  = 0;
+  size_t                m_ones  = 0;
+  std::vector<uint64_t> m_counts;
+  std::vector<size_t>   m_samples;
+};
+
+} // namespace tight_uint
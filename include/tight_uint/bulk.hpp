@@ -0,0 +1,1103 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <tight_uint/cpu.hpp>
+#include <type_traits>
+#include <utility>
+
+// Bulk kernels operating directly on the packed words. These are the fast
+// paths behind unpack(), pack() and copy() in tight_uint.hpp. Words are
+// addressed by a pointer to the first word and a bit offset, which may be
+// larger than a word.
+namespace tight_uint::detail {
+
+template <class T>
+constexpr size_t word_bits = sizeof(T) * 8;
+
+// The packing pattern repeats every lcm(bits, word bits) bits. Splitting a
+// range at multiples of group_values keeps the pieces on word boundaries.
+template <size_t bits, class T>
+constexpr size_t group_values = std::lcm(bits, word_bits<T>) / bits;
+
+template <size_t bits, class T>
+constexpr size_t group_words = std::lcm(bits, word_bits<T>) / word_bits<T>;
+
+template <size_t bits, class T>
+constexpr T mask_bits() {
+  static_assert(bits < word_bits<T>);
+  return static_cast<T>((T(1) << bits) - 1);
+}
+
+// Number of values to skip from bit_offset before a value starts on a word
+// boundary, or count if that does not happen within count values
+template <size_t bits, class T>
+constexpr size_t aligned_head(size_t bit_offset, size_t count) {
+  size_t head = 0;
+  while (head < count && (bit_offset + head * bits) % word_bits<T> != 0) {
+    if (++head == group_values<bits, T>)
+      return count;
+  }
+  return head;
+}
+
+// Decodes a single value
+template <size_t bits, class T>
+constexpr T unpack_value(const T* words, size_t bit_offset) {
+  constexpr size_t s_bits = word_bits<T>;
+  const T*         word   = words + bit_offset / s_bits;
+  size_t           shift  = bit_offset % s_bits;
+  T                result = static_cast<T>(word[0] >> shift);
+  if constexpr (s_bits % bits != 0) {
+    if (shift > s_bits - bits)
+      result |= static_cast<T>(word[1] << (s_bits - shift));
+  }
+  return result & mask_bits<bits, T>();
+}
+
+// Decodes value i of a group with constant shifts
+template <size_t bits, class T, size_t i>
+constexpr T unpack_group_value(const T* words) {
+  constexpr size_t s_bits = word_bits<T>;
+  constexpr size_t word   = i * bits / s_bits;
+  constexpr size_t shift  = i * bits % s_bits;
+  if constexpr (shift + bits <= s_bits) {
+    return static_cast<T>(words[word] >> shift) & mask_bits<bits, T>();
+  } else {
+    return static_cast<T>((words[word] >> shift) |
+                          (words[word + 1] << (s_bits - shift))) &
+           mask_bits<bits, T>();
+  }
+}
+
+// Decodes group_values values from group_words words, fully unrolled
+template <size_t bits, class T, class Out, size_t... i>
+constexpr void unpack_group(const T* words, Out* out,
+                            std::index_sequence<i...>) {
+  ((out[i] = static_cast<Out>(unpack_group_value<bits, T, i>(words))), ...);
+}
+
+template <size_t bits, class T, class Out>
+constexpr void unpack_group(const T* words, Out* out) {
+  unpack_group<bits>(words, out,
+                     std::make_index_sequence<group_values<bits, T>>());
+}
+
+template <size_t bits, class T, class In, size_t i>
+constexpr void pack_group_value(T* words, const In* in) {
+  constexpr size_t s_bits = word_bits<T>;
+  constexpr size_t word   = i * bits / s_bits;
+  constexpr size_t shift  = i * bits % s_bits;
+  T value = static_cast<T>(in[i]) & mask_bits<bits, T>();
+  words[word] |= static_cast<T>(value << shift);
+  if constexpr (shift + bits > s_bits)
+    words[word + 1] |= static_cast<T>(value >> (s_bits - shift));
+}
+
+// Encodes group_values values into group_words words, fully unrolled. Every
+// word is overwritten.
+template <size_t bits, class T, class In, size_t... i>
+constexpr void pack_group(T* words, const In* in, std::index_sequence<i...>) {
+  T result[group_words<bits, T>]{};
+  (pack_group_value<bits, T, In, i>(result, in), ...);
+  for (size_t w = 0; w < group_words<bits, T>; ++w)
+    words[w] = result[w];
+}
+
+template <size_t bits, class T, class In>
+constexpr void pack_group(T* words, const In* in) {
+  pack_group<bits>(words, in,
+                   std::make_index_sequence<group_values<bits, T>>());
+}
+
+// Portable decode. Keeps the current word in a register and only loads the
+// next word once the current one runs out, so interior values are one shift
+// and mask.
+template <size_t bits, class T, class Out>
+constexpr void unpack_stream(const T* words, size_t bit_offset, size_t count,
+                             Out* out) {
+  constexpr size_t s_bits = word_bits<T>;
+  constexpr T      s_mask = mask_bits<bits, T>();
+  if (count == 0)
+    return;
+  words += bit_offset / s_bits;
+  size_t avail = s_bits - bit_offset % s_bits;
+  T      acc   = static_cast<T>(*words++ >> (bit_offset % s_bits));
+  for (size_t i = 0; i < count; ++i) {
+    if (avail >= bits) {
+      out[i] = static_cast<Out>(acc & s_mask);
+      acc    = static_cast<T>(acc >> bits);
+      avail -= bits;
+    } else {
+      T next = *words++;
+      out[i] = static_cast<Out>((acc | static_cast<T>(next << avail)) & s_mask);
+      acc    = static_cast<T>(next >> (bits - avail));
+      avail  = s_bits - (bits - avail);
+    }
+  }
+}
+
+// Streams the values before the first word boundary, then decodes whole
+// groups with no per-value branches, then streams the rest
+template <size_t bits, class T, class Out>
+constexpr void unpack_scalar(const T* words, size_t bit_offset, size_t count,
+                             Out* out) {
+  constexpr size_t s_values = group_values<bits, T>;
+  size_t           head     = aligned_head<bits, T>(bit_offset, count);
+  unpack_stream<bits>(words, bit_offset, head, out);
+  bit_offset += head * bits;
+  count -= head;
+  out += head;
+  const T* group = words + bit_offset / word_bits<T>;
+  for (; count >= s_values; count -= s_values, out += s_values) {
+    unpack_group<bits>(group, out);
+    group += group_words<bits, T>;
+    bit_offset += s_values * bits;
+  }
+  unpack_stream<bits>(words, bit_offset, count, out);
+}
+
+// Decoding four 32-bit lanes needs the first byte and shift of the last value
+// to fit in 16 bytes, and the value plus shift to fit in 32 bits
+template <size_t bits>
+constexpr bool simd_unpack_supported = bits <= 25;
+
+// pdep and pext move every field between a packed word and the lanes of a
+// word of 8 or 16 bit values at once. A lane must hold a value, and one
+// 64-bit load must cover a word of lanes' values after shifting by the first
+// bit within a byte. Converting lanes to or from wider values costs more than
+// the scalar code.
+template <size_t bits, class V>
+constexpr bool bmi2_lanes_supported =
+    std::endian::native == std::endian::little &&
+    ((std::is_same_v<V, uint8_t> && bits <= 7) ||
+     (std::is_same_v<V, uint16_t> && bits <= 14));
+
+// The low bits of every lane of a word
+template <size_t bits, class V>
+constexpr uint64_t bmi2_lane_mask() {
+  uint64_t result = 0;
+  for (size_t i = 0; i < 64; i += word_bits<V>)
+    result |= mask_bits<bits, uint64_t>() << i;
+  return result;
+}
+
+#if defined(TIGHT_UINT_SSE41)
+
+// Values are decoded four at a time into 32-bit lanes of a 128-bit register
+// with a byte shuffle, then shifted left to drop the bits above the value and
+// right to drop the bits below it. Eight values always cover exactly `bits`
+// bytes, so the shuffles only depend on the starting bit within a byte and are
+// built at compile time for each of the 8 possibilities.
+struct unpack_quarter {
+  uint8_t  byte_offset;
+  uint8_t  shuffle[16];
+  uint32_t shift[4];
+};
+
+template <size_t bits>
+constexpr std::array<std::array<unpack_quarter, 4>, 8> make_unpack_tables() {
+  std::array<std::array<unpack_quarter, 4>, 8> result{};
+  for (size_t r = 0; r < 8; ++r) {
+    for (size_t q = 0; q < 4; ++q) {
+      size_t          start   = r + q * 4 * bits;
+      unpack_quarter& quarter = result[r][q];
+      quarter.byte_offset     = static_cast<uint8_t>(start / 8);
+      for (size_t lane = 0; lane < 4; ++lane) {
+        size_t lane_start = start % 8 + lane * bits;
+        for (size_t b = 0; b < 4; ++b)
+          quarter.shuffle[lane * 4 + b] =
+              static_cast<uint8_t>(lane_start / 8 + b);
+        quarter.shift[lane] = static_cast<uint32_t>(32 - bits - lane_start % 8);
+      }
+    }
+  }
+  return result;
+}
+
+template <size_t bits>
+inline constexpr auto unpack_tables = make_unpack_tables<bits>();
+
+// No variable shift before AVX2, so lanes are shifted left by multiplying
+// them by powers of two
+TIGHT_UINT_TARGET("sse4.1")
+inline __m128i unpack_scale_sse(const unpack_quarter& quarter) {
+  return _mm_setr_epi32(1u << quarter.shift[0], 1u << quarter.shift[1],
+                        1u << quarter.shift[2], 1u << quarter.shift[3]);
+}
+
+template <size_t bits>
+TIGHT_UINT_TARGET("sse4.1")
+inline __m128i unpack_quarter_sse(const uint8_t* bytes, __m128i shuffle,
+                                  __m128i scale) {
+  __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+  in         = _mm_mullo_epi32(_mm_shuffle_epi8(in, shuffle), scale);
+  return _mm_srli_epi32(in, 32 - bits);
+}
+
+// The SIMD decoders continue from value i, a multiple of 8, and return the
+// index after the last value written. `end_bytes` bounds the loads relative
+// to `bytes`. Table entries are loaded into registers first, since the
+// compiler must assume stores to out may change them.
+
+// 8 values per iteration, advancing bits bytes
+template <size_t bits>
+TIGHT_UINT_TARGET("sse4.1")
+size_t unpack_sse41(const uint8_t* bytes, size_t bit_offset, size_t end_bytes,
+                    size_t count, uint32_t* out, size_t i) {
+  const auto&   tables   = unpack_tables<bits>[bit_offset % 8];
+  size_t        byte     = bit_offset / 8 + i / 8 * bits;
+  const size_t  offset0  = tables[0].byte_offset;
+  const size_t  offset1  = tables[1].byte_offset;
+  const __m128i shuffle0 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables[0].shuffle));
+  const __m128i shuffle1 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables[1].shuffle));
+  const __m128i scale0 = unpack_scale_sse(tables[0]);
+  const __m128i scale1 = unpack_scale_sse(tables[1]);
+  for (; i + 8 <= count && byte + offset1 + 16 <= end_bytes;
+       i += 8, byte += bits) {
+    const uint8_t* p = bytes + byte;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     unpack_quarter_sse<bits>(p + offset0, shuffle0, scale0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4),
+                     unpack_quarter_sse<bits>(p + offset1, shuffle1, scale1));
+  }
+  return i;
+}
+
+#if defined(TIGHT_UINT_AVX2)
+
+// 8 values per iteration in one register, advancing bits bytes
+template <size_t bits>
+TIGHT_UINT_TARGET("avx2")
+size_t unpack_avx2(const uint8_t* bytes, size_t bit_offset, size_t end_bytes,
+                   size_t count, uint32_t* out, size_t i) {
+  const auto&   tables   = unpack_tables<bits>[bit_offset % 8];
+  size_t        byte     = bit_offset / 8 + i / 8 * bits;
+  const __m256i shuffle8 = _mm256_setr_m128i(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables[0].shuffle)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables[1].shuffle)));
+  const __m256i shift8 = _mm256_setr_epi32(
+      tables[0].shift[0], tables[0].shift[1], tables[0].shift[2],
+      tables[0].shift[3], tables[1].shift[0], tables[1].shift[1],
+      tables[1].shift[2], tables[1].shift[3]);
+  for (; i + 8 <= count && byte + tables[1].byte_offset + 16 <= end_bytes;
+       i += 8, byte += bits) {
+    const uint8_t* p  = bytes + byte;
+    __m256i        in = _mm256_setr_m128i(
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(p + tables[0].byte_offset)),
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(p + tables[1].byte_offset)));
+    in = _mm256_shuffle_epi8(in, shuffle8);
+    in = _mm256_sllv_epi32(in, shift8);
+    in = _mm256_srli_epi32(in, 32 - bits);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), in);
+  }
+  return i;
+}
+
+#endif
+
+#if defined(TIGHT_UINT_AVX512BW)
+
+// 16 values per iteration, advancing 2 * bits bytes
+template <size_t bits>
+TIGHT_UINT_TARGET("avx512bw")
+size_t unpack_avx512(const uint8_t* bytes, size_t bit_offset,
+                     size_t end_bytes, size_t count, uint32_t* out, size_t i) {
+  const auto&   tables  = unpack_tables<bits>[bit_offset % 8];
+  size_t        byte    = bit_offset / 8 + i / 8 * bits;
+  const __m512i shuffle = _mm512_inserti32x4(
+      _mm512_inserti32x4(
+          _mm512_inserti32x4(
+              _mm512_zextsi128_si512(_mm_loadu_si128(
+                  reinterpret_cast<const __m128i*>(tables[0].shuffle))),
+              _mm_loadu_si128(
+                  reinterpret_cast<const __m128i*>(tables[1].shuffle)),
+              1),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables[2].shuffle)),
+          2),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables[3].shuffle)), 3);
+  const __m512i shift = _mm512_setr_epi32(
+      tables[0].shift[0], tables[0].shift[1], tables[0].shift[2],
+      tables[0].shift[3], tables[1].shift[0], tables[1].shift[1],
+      tables[1].shift[2], tables[1].shift[3], tables[2].shift[0],
+      tables[2].shift[1], tables[2].shift[2], tables[2].shift[3],
+      tables[3].shift[0], tables[3].shift[1], tables[3].shift[2],
+      tables[3].shift[3]);
+  for (; i + 16 <= count && byte + tables[3].byte_offset + 16 <= end_bytes;
+       i += 16, byte += 2 * bits) {
+    const uint8_t* p    = bytes + byte;
+    auto           load = [p, &tables](size_t q) {
+      return _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(p + tables[q].byte_offset));
+    };
+    __m512i in = _mm512_inserti32x4(
+        _mm512_inserti32x4(
+            _mm512_inserti32x4(_mm512_zextsi128_si512(load(0)), load(1), 1),
+            load(2), 2),
+        load(3), 3);
+    in = _mm512_shuffle_epi8(in, shuffle);
+    // The zero-masked forms, since GCC 12 warns that the unmasked ones read
+    // an undefined register
+    in = _mm512_maskz_sllv_epi32(0xffff, in, shift);
+    in = _mm512_maskz_srli_epi32(0xffff, in, 32 - bits);
+    _mm512_storeu_si512(out + i, in);
+  }
+  return i;
+}
+
+#endif
+
+// Decodes as many values as possible with the widest SIMD the CPU has and
+// returns the number written. AVX-512 leaves up to 15 values for AVX2.
+template <size_t bits>
+size_t unpack_simd(const uint8_t* bytes, size_t bit_offset, size_t end_bytes,
+                   size_t count, uint32_t* out) {
+  size_t i = 0;
+#if defined(TIGHT_UINT_AVX512BW)
+  if (cpu().avx512bw)
+    i = unpack_avx512<bits>(bytes, bit_offset, end_bytes, count, out, i);
+#endif
+#if defined(TIGHT_UINT_AVX2)
+  if (cpu().avx2)
+    return unpack_avx2<bits>(bytes, bit_offset, end_bytes, count, out, i);
+#endif
+  if (cpu().sse41)
+    i = unpack_sse41<bits>(bytes, bit_offset, end_bytes, count, out, i);
+  return i;
+}
+
+#endif
+
+#if defined(TIGHT_UINT_BMI2)
+
+// Decodes a word of lanes per pdep, depositing the consecutive fields of an
+// unaligned 64-bit load into the lanes, and returns the number written.
+// `end_bytes` bounds the loads relative to `bytes`.
+template <size_t bits, class V>
+TIGHT_UINT_TARGET("bmi2")
+size_t unpack_bmi2(const uint8_t* bytes, size_t bit_offset, size_t end_bytes,
+                   size_t count, V* out) {
+  constexpr size_t   s_lanes = sizeof(uint64_t) / sizeof(V);
+  constexpr uint64_t s_mask  = bmi2_lane_mask<bits, V>();
+  size_t             i       = 0;
+  for (; i + s_lanes <= count && bit_offset / 8 + 8 <= end_bytes;
+       i += s_lanes, bit_offset += s_lanes * bits) {
+    uint64_t in;
+    std::memcpy(&in, bytes + bit_offset / 8, sizeof(in));
+    uint64_t lanes = _pdep_u64(in >> (bit_offset % 8), s_mask);
+    std::memcpy(out + i, &lanes, sizeof(lanes));
+  }
+  return i;
+}
+
+#endif
+
+// Decodes `count` values starting `bit_offset` bits into `words`. Reads no
+// further than the word holding the last value's final bit. The SIMD kernels
+// decode to uint32_t and BMI2 to uint8_t and uint16_t, each if the CPU has
+// it.
+template <size_t bits, class T, class Out>
+void unpack_bits(const T* words, size_t bit_offset, size_t count, Out* out) {
+  if constexpr (std::endian::native == std::endian::little) {
+    constexpr size_t                s_bits = word_bits<T>;
+    [[maybe_unused]] const uint8_t* bytes =
+        reinterpret_cast<const uint8_t*>(words);
+    [[maybe_unused]] size_t end_bytes =
+        (bit_offset + count * bits + s_bits - 1) / s_bits * sizeof(T);
+    size_t done = 0;
+#if defined(TIGHT_UINT_SSE41)
+    if constexpr (std::is_same_v<Out, uint32_t> && simd_unpack_supported<bits>)
+      done = unpack_simd<bits>(bytes, bit_offset, end_bytes, count, out);
+#endif
+#if defined(TIGHT_UINT_BMI2)
+    if constexpr (bmi2_lanes_supported<bits, Out>)
+      if (cpu().bmi2)
+        done += unpack_bmi2<bits>(bytes, bit_offset + done * bits, end_bytes,
+                                  count - done, out + done);
+#endif
+    bit_offset += done * bits;
+    count -= done;
+    out += done;
+  }
+  unpack_scalar<bits>(words, bit_offset, count, out);
+}
+
+// Portable encode. Values are accumulated in a register and whole words are
+// stored as they fill up. Only the first and last words are read to preserve
+// their neighbouring bits.
+template <size_t bits, class T, class In>
+constexpr void pack_stream(T* words, size_t bit_offset, size_t count,
+                           const In* in) {
+  constexpr size_t s_bits = word_bits<T>;
+  constexpr T      s_mask = mask_bits<bits, T>();
+  if (count == 0)
+    return;
+  words += bit_offset / s_bits;
+  size_t used = bit_offset % s_bits;
+  T      acc  = static_cast<T>(*words & ((T(1) << used) - 1));
+  for (size_t i = 0; i < count; ++i) {
+    T value = static_cast<T>(in[i]) & s_mask;
+    acc |= static_cast<T>(value << used);
+    used += bits;
+    if (used >= s_bits) {
+      *words++ = acc;
+      used -= s_bits;
+      acc = used ? static_cast<T>(value >> (bits - used)) : T(0);
+    }
+  }
+  if (used) {
+    T keep = static_cast<T>(~((T(1) << used) - 1));
+    *words = static_cast<T>((*words & keep) | acc);
+  }
+}
+
+// Like unpack_scalar(). Whole groups are written without reading the
+// destination.
+template <size_t bits, class T, class In>
+constexpr void pack_scalar(T* words, size_t bit_offset, size_t count,
+                           const In* in) {
+  constexpr size_t s_values = group_values<bits, T>;
+  size_t           head     = aligned_head<bits, T>(bit_offset, count);
+  pack_stream<bits>(words, bit_offset, head, in);
+  bit_offset += head * bits;
+  count -= head;
+  in += head;
+  T* group = words + bit_offset / word_bits<T>;
+  for (; count >= s_values; count -= s_values, in += s_values) {
+    pack_group<bits>(group, in);
+    group += group_words<bits, T>;
+    bit_offset += s_values * bits;
+  }
+  pack_stream<bits>(words, bit_offset, count, in);
+}
+
+#if defined(TIGHT_UINT_BMI2)
+
+// Encodes groups of 8 values, each filling exactly `bits` bytes, and returns
+// the number written. The output must start on a byte boundary. Each word of
+// lanes is gathered into contiguous fields with one pext, which also drops
+// the bits above each value. Whole 64-bit words are stored one at a time
+// while later values overwrite the excess, since copying the fields as a
+// block goes through the stack and stalls store forwarding.
+template <size_t bits, class V>
+TIGHT_UINT_TARGET("bmi2")
+size_t pack_bmi2(uint8_t* bytes, size_t count, const V* in) {
+  constexpr size_t   s_lanes = sizeof(uint64_t) / sizeof(V);
+  constexpr size_t   s_words = 8 / s_lanes;
+  constexpr uint64_t s_mask  = bmi2_lane_mask<bits, V>();
+  size_t             i       = 0;
+  for (; i + 8 <= count; i += 8, bytes += bits) {
+    uint64_t fields[2] = {};
+    for (size_t w = 0; w < s_words; ++w) {
+      uint64_t lanes;
+      std::memcpy(&lanes, in + i + w * s_lanes, sizeof(lanes));
+      fields[w] = _pext_u64(lanes, s_mask);
+    }
+    if constexpr (s_words == 2) {
+      fields[0] |= fields[1] << (s_lanes * bits);
+      fields[1] >>= 64 - s_lanes * bits;
+    }
+    if ((count - i) * bits / 8 >= s_words * 8) {
+      for (size_t w = 0; w < s_words; ++w)
+        std::memcpy(bytes + w * 8, &fields[w], 8);
+    } else {
+      std::memcpy(bytes, fields, bits);
+    }
+  }
+  return i;
+}
+
+#endif
+
+// Encodes `count` values starting `bit_offset` bits into `words`. Bits outside
+// the written range are preserved.
+template <size_t bits, class T, class In>
+void pack_bits(T* words, size_t bit_offset, size_t count, const In* in) {
+#if defined(TIGHT_UINT_BMI2)
+  if constexpr (bmi2_lanes_supported<bits, std::remove_const_t<In>>) {
+    // Write the head with the scalar path until a whole word boundary
+    size_t head = aligned_head<bits, T>(bit_offset, count);
+    if (cpu().bmi2 && (bit_offset + head * bits) % word_bits<T> == 0) {
+      pack_stream<bits>(words, bit_offset, head, in);
+      bit_offset += head * bits;
+      count -= head;
+      in += head;
+      size_t done = pack_bmi2<bits>(
+          reinterpret_cast<uint8_t*>(words) + bit_offset / 8, count, in);
+      bit_offset += done * bits;
+      count -= done;
+      in += done;
+    }
+  }
+#endif
+  pack_scalar<bits>(words, bit_offset, count, in);
+}
+
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#endif
+}
+
+template <size_t bits, class T>
+constexpr bool simd_gather_supported =
+    (std::is_same_v<T, uint32_t> || std::is_same_v<T, uint64_t>) &&
+    bits <= 57 && std::endian::native == std::endian::little;
+
+template <size_t bits>
+constexpr bool bmi2_gather_supported =
+    bits <= 57 && std::endian::native == std::endian::little;
+
+#if defined(TIGHT_UINT_AVX2)
+
+// Gathers four values at a time with one unaligned 64-bit load from each
+// value's first byte, then shifts by its bit offset within that byte. Indices
+// whose load would pass size_bytes are left to the caller. Returns the number
+// of values written.
+template <size_t bits, class T>
+TIGHT_UINT_TARGET("avx2")
+size_t gather_avx2(const uint8_t* bytes, size_t size_bytes,
+                   const size_t* indices, size_t count, T* out,
+                   size_t distance) {
+  if (size_bytes < 8)
+    return 0;
+  const __m256i limit = _mm256_set1_epi64x(
+      static_cast<long long>((size_bytes - 8) * 8 / bits));
+  const __m256i width = _mm256_set1_epi64x(bits);
+  const __m256i mask  = _mm256_set1_epi64x(
+      static_cast<long long>(mask_bits<bits, uint64_t>()));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    for (size_t j = i + distance; distance && j < i + distance + 4; ++j)
+      if (j < count)
+        prefetch(bytes + indices[j] * bits / 8);
+    __m256i index =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+    if (_mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpgt_epi64(index, limit))))
+      break;
+    // 64-bit index * bits, from two 32x32 multiplies
+    __m256i bit = _mm256_add_epi64(
+        _mm256_mul_epu32(index, width),
+        _mm256_slli_epi64(
+            _mm256_mul_epu32(_mm256_srli_epi64(index, 32), width), 32));
+    __m256i value = _mm256_i64gather_epi64(
+        reinterpret_cast<const long long*>(bytes),
+        _mm256_srli_epi64(bit, 3), 1);
+    value = _mm256_and_si256(
+        _mm256_srlv_epi64(value, _mm256_and_si256(bit, _mm256_set1_epi64x(7))),
+        mask);
+    if constexpr (sizeof(T) == 8) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), value);
+    } else {
+      __m256i low = _mm256_permutevar8x32_epi32(
+          value, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                       _mm256_castsi256_si128(low));
+    }
+  }
+  return i;
+}
+
+#endif
+
+#if defined(TIGHT_UINT_BMI2)
+
+// Reads each value with one unaligned 64-bit load from its first byte, shrx
+// and bzhi, with no branch for values that straddle two words. Stops at the
+// first index whose load would pass size_bytes and returns the number of
+// values written.
+template <size_t bits, class T>
+TIGHT_UINT_TARGET("bmi2")
+size_t gather_bmi2(const uint8_t* bytes, size_t size_bytes,
+                   const size_t* indices, size_t count, T* out,
+                   size_t distance) {
+  if (size_bytes < 8)
+    return 0;
+  size_t limit = (size_bytes - 8) * 8 / bits;
+  size_t i     = 0;
+  for (; i < count && indices[i] <= limit; ++i) {
+    if (distance && i + distance < count)
+      prefetch(bytes + indices[i + distance] * bits / 8);
+    size_t   bit = indices[i] * bits;
+    uint64_t value;
+    std::memcpy(&value, bytes + bit / 8, sizeof(value));
+    out[i] = static_cast<T>(_bzhi_u64(value >> (bit % 8), bits));
+  }
+  return i;
+}
+
+#endif
+
+// Reads the values at indices into out, prefetching the word distance
+// indices ahead so many cache misses are in flight at once. size_bytes bounds
+// the SIMD and BMI2 loads.
+template <size_t bits, class T>
+void gather_bits(const T* words, [[maybe_unused]] size_t size_bytes,
+                 const size_t* indices, size_t count, T* out,
+                 size_t distance) {
+  [[maybe_unused]] const uint8_t* bytes =
+      reinterpret_cast<const uint8_t*>(words);
+  size_t i = 0;
+  while (i < count) {
+    bool kernel = false;
+#if defined(TIGHT_UINT_AVX2)
+    if constexpr (simd_gather_supported<bits, T>) {
+      if (cpu().avx2) {
+        i += gather_avx2<bits>(bytes, size_bytes, indices + i, count - i,
+                               out + i, distance);
+        kernel = true;
+      }
+    }
+#endif
+#if defined(TIGHT_UINT_BMI2)
+    if constexpr (bmi2_gather_supported<bits>) {
+      if (cpu().bmi2) {
+        i += gather_bmi2<bits>(bytes, size_bytes, indices + i, count - i,
+                               out + i, distance);
+        kernel = true;
+      }
+    }
+#endif
+    if (i == count)
+      break;
+    // Scalar until the end, or for a few values a kernel could not load
+    size_t last = kernel ? std::min(count, i + 4) : count;
+    for (; i < last; ++i) {
+      if (distance && i + distance < count)
+        prefetch(words + indices[i + distance] * bits / word_bits<T>);
+      out[i] = unpack_value<bits>(words, indices[i] * bits);
+    }
+  }
+}
+
+// Reads count <= word bits bits starting at bit_offset. Only touches the
+// second word if the bits straddle it.
+template <class T>
+constexpr T load_bits(const T* words, size_t bit_offset, size_t count) {
+  constexpr size_t s_bits = word_bits<T>;
+  const T*         word   = words + bit_offset / s_bits;
+  size_t           shift  = bit_offset % s_bits;
+  T                result = static_cast<T>(word[0] >> shift);
+  if (shift + count > s_bits)
+    result |= static_cast<T>(word[1] << (s_bits - shift));
+  if (count < s_bits)
+    result &= static_cast<T>((T(1) << count) - 1);
+  return result;
+}
+
+// Writes the low count <= word bits bits of value, preserving the rest
+template <class T>
+constexpr void store_bits(T* words, size_t bit_offset, size_t count,
+                          T value) {
+  constexpr size_t s_bits = word_bits<T>;
+  T*               word   = words + bit_offset / s_bits;
+  size_t           shift  = bit_offset % s_bits;
+  T mask = count < s_bits ? static_cast<T>((T(1) << count) - 1) : T(~T(0));
+  word[0] = static_cast<T>((word[0] & ~(mask << shift)) | (value << shift));
+  if (shift + count > s_bits) {
+    size_t next_shift = s_bits - shift;
+    word[1]           = static_cast<T>((word[1] & ~(mask >> next_shift)) |
+                                       (value >> next_shift));
+  }
+}
+
+// Copies count bits from src to dst front to back, so dst may overlap the
+// source if it starts before it. Whole destination words are written with one
+// funnel shift of two source words, or a plain word copy when the offsets
+// agree.
+template <class T>
+constexpr void copy_bits(const T* src, size_t src_bit, T* dst, size_t dst_bit,
+                         size_t count) {
+  constexpr size_t s_bits = word_bits<T>;
+  // Partial head up to a destination word boundary
+  size_t head = std::min(count, (s_bits - dst_bit % s_bits) % s_bits);
+  if (head) {
+    store_bits(dst, dst_bit, head, load_bits(src, src_bit, head));
+    dst_bit += head;
+    src_bit += head;
+    count -= head;
+  }
+  size_t   full  = count / s_bits;
+  T*       out   = dst + dst_bit / s_bits;
+  const T* in    = src + src_bit / s_bits;
+  size_t   shift = src_bit % s_bits;
+  if (shift == 0) {
+    std::copy(in, in + full, out);
+  } else {
+    for (size_t i = 0; i < full; ++i)
+      out[i] = static_cast<T>((in[i] >> shift) |
+                              (in[i + 1] << (s_bits - shift)));
+  }
+  count -= full * s_bits;
+  if (count)
+    store_bits(dst, dst_bit + full * s_bits, count,
+               load_bits(src, src_bit + full * s_bits, count));
+}
+
+// Bit level memmove of count bits from src_bit to dst_bit within words. The
+// ranges may overlap. Whole destination words are written with one funnel
+// shift of two source words, or a plain memmove when the offsets agree.
+template <class T>
+void move_bits(T* words, size_t dst_bit, size_t src_bit, size_t count) {
+  constexpr size_t s_bits = word_bits<T>;
+  if (count == 0 || dst_bit == src_bit)
+    return;
+  if (dst_bit < src_bit) {
+    copy_bits(words, src_bit, words, dst_bit, count);
+  } else {
+    // Backwards: partial tail down to a destination word boundary
+    size_t tail = std::min(count, (dst_bit + count) % s_bits);
+    if (tail) {
+      count -= tail;
+      store_bits(words, dst_bit + count, tail,
+                 load_bits(words, src_bit + count, tail));
+    }
+    size_t full = count / s_bits;
+    count -= full * s_bits;
+    T* dst = words + (dst_bit + count) / s_bits;
+    if ((src_bit + count) % s_bits == 0) {
+      std::memmove(dst, words + (src_bit + count) / s_bits, full * sizeof(T));
+    } else {
+      const T* src   = words + (src_bit + count) / s_bits;
+      size_t   shift = (src_bit + count) % s_bits;
+      for (size_t i = full; i-- > 0;)
+        dst[i] = static_cast<T>((src[i] >> shift) |
+                                (src[i + 1] << (s_bits - shift)));
+    }
+    if (count)
+      store_bits(words, dst_bit, count, load_bits(words, src_bit, count));
+  }
+}
+
+// Writes count copies of value from bit_offset. The words repeat every
+// group_words, so one period is built in registers and then stamped with block
+// copies that double in size up to a few KB.
+template <size_t bits, class T>
+constexpr void fill_bits(T* words, size_t bit_offset, size_t count, T value) {
+  constexpr size_t s_bits   = word_bits<T>;
+  constexpr size_t s_period = group_words<bits, T>;
+  constexpr size_t s_block  = 4096 / sizeof(T);
+  value &= mask_bits<bits, T>();
+
+  // The value repeated from bit 0, one period plus a value long so that a
+  // period starting at any phase can be read from it
+  std::array<T, s_period + 1> repeated{};
+  for (size_t i = 0; i <= group_values<bits, T>; ++i)
+    store_bits(repeated.data(), i * bits, bits, value);
+
+  size_t total = count * bits;
+  size_t head  = std::min(total, (s_bits - bit_offset % s_bits) % s_bits);
+  if (head)
+    store_bits(words, bit_offset, head, load_bits(repeated.data(), 0, head));
+  std::array<T, s_period> pattern;
+  for (size_t i = 0; i < s_period; ++i)
+    pattern[i] = load_bits(repeated.data(), head % bits + i * s_bits, s_bits);
+
+  size_t full  = (total - head) / s_bits;
+  T*     out   = words + (bit_offset + head) / s_bits;
+  size_t done  = std::min(full, s_period);
+  size_t block = done;
+  std::copy_n(pattern.begin(), done, out);
+  while (done < full) {
+    // Copies of a whole number of periods stay in phase
+    size_t n = std::min(block, full - done);
+    std::copy_n(out, n, out + done);
+    done += n;
+    if (block < s_block)
+      block = done;
+  }
+  size_t tail = (total - head) % s_bits;
+  if (tail)
+    store_bits(out + full, 0, tail,
+               load_bits(pattern.data() + full % s_period, 0, tail));
+}
+
+// Compares count bits of a from a_bit with b from b_bit. Bits outside the
+// ranges are masked off, so partial words at either end may hold anything.
+template <class T>
+constexpr bool equal_bits(const T* a, size_t a_bit, const T* b, size_t b_bit,
+                          size_t count) {
+  constexpr size_t s_bits = word_bits<T>;
+  // Partial head up to a word boundary in a
+  size_t head = std::min(count, (s_bits - a_bit % s_bits) % s_bits);
+  if (head) {
+    if (load_bits(a, a_bit, head) != load_bits(b, b_bit, head))
+      return false;
+    a_bit += head;
+    b_bit += head;
+    count -= head;
+  }
+  size_t   full  = count / s_bits;
+  const T* x     = a + a_bit / s_bits;
+  const T* y     = b + b_bit / s_bits;
+  size_t   shift = b_bit % s_bits;
+  if (shift == 0) {
+    if (!std::equal(x, x + full, y))
+      return false;
+  } else {
+    for (size_t i = 0; i < full; ++i)
+      if (x[i] != static_cast<T>((y[i] >> shift) |
+                                 (y[i + 1] << (s_bits - shift))))
+        return false;
+  }
+  count -= full * s_bits;
+  return count == 0 || load_bits(a, a_bit + full * s_bits, count) ==
+                           load_bits(b, b_bit + full * s_bits, count);
+}
+
+// Writes f(old, value) to each index in order, prefetching the word distance
+// updates ahead. Each update is one read-modify-write of one or two words.
+template <size_t bits, class T, class Function>
+void scatter_bits(T* words, const size_t* indices, const T* values,
+                  size_t count, Function& f, size_t distance) {
+  constexpr T s_mask = mask_bits<bits, T>();
+  for (size_t i = 0; i < count; ++i) {
+    if (distance && i + distance < count)
+      prefetch(words + indices[i + distance] * bits / word_bits<T>);
+    size_t bit = indices[i] * bits;
+    T      old = unpack_value<bits>(const_cast<const T*>(words), bit);
+    store_bits(words, bit, bits, static_cast<T>(f(old, values[i]) & s_mask));
+  }
+}
+
+// Like scatter_bits() for updates sorted by index, given as (index, position
+// in values) pairs. Updates starting in the same word are merged in registers
+// so each word is read and written once.
+template <size_t bits, class T, class Function>
+void scatter_sorted_bits(T* words, const std::pair<size_t, size_t>* updates,
+                         size_t count, const T* values, Function& f,
+                         size_t distance) {
+  constexpr size_t s_bits = word_bits<T>;
+  constexpr T      s_mask = mask_bits<bits, T>();
+  size_t           i      = 0;
+  while (i < count) {
+    size_t word      = updates[i].first * bits / s_bits;
+    T      local[2]  = {words[word], T(0)};
+    bool   straddles = false;
+    for (; i < count && updates[i].first * bits / s_bits == word; ++i) {
+      if (distance && i + distance < count)
+        prefetch(words + updates[i + distance].first * bits / s_bits);
+      size_t shift = updates[i].first * bits - word * s_bits;
+      if (!straddles && shift + bits > s_bits) {
+        local[1]  = words[word + 1];
+        straddles = true;
+      }
+      T old = load_bits(local, shift, bits);
+      store_bits(local, shift, bits,
+                 static_cast<T>(f(old, values[updates[i].second]) & s_mask));
+    }
+    words[word] = local[0];
+    if (straddles)
+      words[word + 1] = local[1];
+  }
+}
+
+// Re-encodes count values of A bits in T words as B bits in U words. Values
+// pass through a block small enough to stay in L1, so both sides use the SIMD
+// unpack and pack kernels and there is no full size temporary. When narrowing,
+// values either keep their low B bits or, if checked, the block holding the
+// first value that does not fit is not written. Returns the number written.
+template <size_t A, size_t B, class T, class U>
+size_t transcode_bits(const T* src, size_t src_bit, U* dst, size_t dst_bit,
+                      size_t count, bool checked) {
+  if constexpr (A == B && std::is_same_v<T, U>) {
+    copy_bits(src, src_bit, dst, dst_bit, count * A);
+    return count;
+  } else {
+    using block_type =
+        std::conditional_t<(A <= 32 && B <= 32), uint32_t, uint64_t>;
+    std::array<block_type, 256> block;
+    for (size_t done = 0; done < count;) {
+      size_t n = std::min(block.size(), count - done);
+      unpack_bits<A>(src, src_bit + done * A, n, block.data());
+      if constexpr (B < A) {
+        constexpr block_type s_mask =
+            static_cast<block_type>((uint64_t(1) << B) - 1);
+        if (checked) {
+          block_type high = 0;
+          for (size_t i = 0; i < n; ++i)
+            high |= block[i];
+          if (high & ~s_mask)
+            return done;
+        } else {
+          for (size_t i = 0; i < n; ++i)
+            block[i] &= s_mask;
+        }
+      }
+      pack_bits<B>(dst, dst_bit + done * B, n, block.data());
+      done += n;
+    }
+    return count;
+  }
+}
+
+// Decodes count values in blocks of 256 and calls f(values, n) for each, so
+// reductions use the SIMD unpack kernels without a full size buffer. Values
+// are decoded as uint32_t when they fit, which the SIMD kernels require.
+template <size_t bits, class T, class Function>
+void for_each_block(const T* words, size_t bit_offset, size_t count,
+                    Function&& f) {
+  using block_type = std::conditional_t<(bits <= 32), uint32_t, uint64_t>;
+  std::array<block_type, 256> block;
+  for (size_t done = 0; done < count;) {
+    size_t n = std::min(block.size(), count - done);
+    unpack_bits<bits>(words, bit_offset + done * bits, n, block.data());
+    f(static_cast<const block_type*>(block.data()), n);
+    done += n;
+  }
+}
+
+// planes[k][w] selects bit k of every value in word w of a word group
+template <size_t bits, class T>
+constexpr auto bit_planes() {
+  constexpr size_t s_words = group_words<bits, T>;
+  std::array<std::array<T, s_words>, bits> planes{};
+  for (size_t bit = 0; bit < s_words * word_bits<T>; ++bit)
+    planes[bit % bits][bit / word_bits<T>] |=
+        static_cast<T>(T(1) << (bit % word_bits<T>));
+  return planes;
+}
+
+// Widths up to this are summed with popcount rather than decoded. Each word
+// takes one popcount per bit of the width, so this is only a win for very
+// narrow values, and slightly less narrow with a popcount instruction.
+inline size_t popcount_sum_bits() { return cpu().popcnt ? 3 : 2; }
+
+// Adds the set bits of bit plane k in groups word groups to ones[k]
+template <size_t bits, class T>
+void count_planes(const T* word, size_t groups, uint64_t* ones) {
+  constexpr size_t s_words  = group_words<bits, T>;
+  constexpr auto   s_planes = bit_planes<bits, T>();
+  for (size_t g = 0; g < groups; ++g, word += s_words)
+    for (size_t w = 0; w < s_words; ++w)
+      for (size_t k = 0; k < bits; ++k)
+        ones[k] += std::popcount(static_cast<T>(word[w] & s_planes[k][w]));
+}
+
+#if defined(TIGHT_UINT_POPCNT)
+
+template <size_t bits, class T>
+TIGHT_UINT_TARGET("popcnt")
+void count_planes_popcnt(const T* word, size_t groups, uint64_t* ones) {
+  constexpr size_t s_words  = group_words<bits, T>;
+  constexpr auto   s_planes = bit_planes<bits, T>();
+  for (size_t g = 0; g < groups; ++g, word += s_words)
+    for (size_t w = 0; w < s_words; ++w)
+      for (size_t k = 0; k < bits; ++k)
+        ones[k] += static_cast<uint64_t>(
+            __builtin_popcountll(uint64_t(word[w] & s_planes[k][w])));
+}
+
+#endif
+
+// Sum of count values. Each block is first added in 32 bit lanes when that
+// cannot overflow, which vectorizes better, then into the 64 bit total. Small
+// widths count the set bits of each bit plane with popcount instead.
+template <size_t bits, class T>
+uint64_t sum_bits(const T* words, size_t bit_offset, size_t count) {
+  uint64_t total = 0;
+  auto     add   = [&total](const auto* values, size_t n) {
+    if constexpr (bits + 8 <= 32) {
+      uint32_t block_total = 0; // n <= 2^8
+      for (size_t i = 0; i < n; ++i)
+        block_total += values[i];
+      total += block_total;
+    } else {
+      for (size_t i = 0; i < n; ++i)
+        total += values[i];
+    }
+  };
+  if constexpr (bits <= 3) {
+    if (bits <= popcount_sum_bits()) {
+      // Decode up to the first whole word group
+      size_t head = aligned_head<bits, T>(bit_offset, count);
+      for_each_block<bits>(words, bit_offset, head, add);
+      bit_offset += head * bits;
+      count -= head;
+
+      size_t   groups = count / group_values<bits, T>;
+      const T* word   = words + bit_offset / word_bits<T>;
+      std::array<uint64_t, bits> ones{};
+#if defined(TIGHT_UINT_POPCNT)
+      if (cpu().popcnt)
+        count_planes_popcnt<bits>(word, groups, ones.data());
+      else
+#endif
+        count_planes<bits>(word, groups, ones.data());
+      for (size_t k = 0; k < bits; ++k)
+        total += ones[k] << k;
+      bit_offset += groups * group_values<bits, T> * bits;
+      count -= groups * group_values<bits, T>;
+    }
+  }
+  for_each_block<bits>(words, bit_offset, count, add);
+  return total;
+}
+
+// Smallest and largest of count > 0 values
+template <size_t bits, class T>
+std::pair<T, T> min_max_bits(const T* words, size_t bit_offset,
+                             size_t count) {
+  uint64_t lo = mask_bits<bits, T>();
+  uint64_t hi = 0;
+  for_each_block<bits>(words, bit_offset, count,
+                       [&](const auto* values, size_t n) {
+                         auto block_lo = values[0];
+                         auto block_hi = values[0];
+                         for (size_t i = 1; i < n; ++i) {
+                           block_lo = std::min(block_lo, values[i]);
+                           block_hi = std::max(block_hi, values[i]);
+                         }
+                         lo = std::min<uint64_t>(lo, block_lo);
+                         hi = std::max<uint64_t>(hi, block_hi);
+                       });
+  return {static_cast<T>(lo), static_cast<T>(hi)};
+}
+
+// Number of values equal to value
+template <size_t bits, class T>
+size_t count_bits(const T* words, size_t bit_offset, size_t count, T value) {
+  if constexpr (bits == 1) {
+    size_t ones = sum_bits<bits>(words, bit_offset, count);
+    return value == 1 ? ones : value == 0 ? count - ones : 0;
+  } else {
+    size_t result = 0;
+    for_each_block<bits>(words, bit_offset, count,
+                         [&](const auto* values, size_t n) {
+                           for (size_t i = 0; i < n; ++i)
+                             result += values[i] == value;
+                         });
+    return result;
+  }
+}
+
+// Adds the number of times each value occurs to counts[value]
+template <size_t bits, class T>
+void histogram_bits(const T* words, size_t bit_offset, size_t count,
+                    size_t* counts) {
+  if constexpr (bits == 1) {
+    size_t ones = sum_bits<bits>(words, bit_offset, count);
+    counts[0] += count - ones;
+    counts[1] += ones;
+  } else {
+    for_each_block<bits>(words, bit_offset, count,
+                         [&](const auto* values, size_t n) {
+                           for (size_t i = 0; i < n; ++i)
+                             ++counts[values[i]];
+                         });
+  }
+}
+
+} // namespace tight_uint::detail
@@ -0,0 +1,110 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+// Instruction set selection for the bulk kernels. With GCC or Clang on x86-64
+// every SIMD, BMI2 and popcnt kernel is compiled with a target attribute,
+// whatever the build flags, and cpu() picks among them at run time. One build
+// then runs on any x86-64 CPU and still uses AVX-512 where it exists.
+// Elsewhere, or with TIGHT_UINT_NO_DISPATCH defined, only the kernels the
+// build flags enable are compiled and cpu() reports those flags.
+#if !defined(TIGHT_UINT_NO_DISPATCH) && defined(__x86_64__) &&                \
+    (defined(__GNUC__) || defined(__clang__))
+#define TIGHT_UINT_DISPATCH 1
+#define TIGHT_UINT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TIGHT_UINT_TARGET(isa)
+#endif
+
+#if defined(TIGHT_UINT_DISPATCH) || defined(__SSE4_1__)
+#define TIGHT_UINT_SSE41 1
+#endif
+#if defined(TIGHT_UINT_DISPATCH) || defined(__AVX2__)
+#define TIGHT_UINT_AVX2 1
+#endif
+#if defined(TIGHT_UINT_DISPATCH) || defined(__AVX512BW__)
+#define TIGHT_UINT_AVX512BW 1
+#endif
+#if defined(TIGHT_UINT_DISPATCH) || defined(__BMI2__)
+#define TIGHT_UINT_BMI2 1
+#endif
+#if defined(TIGHT_UINT_DISPATCH) || defined(__POPCNT__)
+#define TIGHT_UINT_POPCNT 1
+#endif
+
+#if defined(TIGHT_UINT_SSE41) || defined(TIGHT_UINT_BMI2)
+#include <immintrin.h>
+#endif
+
+namespace tight_uint {
+
+// Instruction set extensions the bulk kernels may use
+struct cpu_features {
+  bool sse41    = false;
+  bool avx2     = false;
+  bool avx512bw = false;
+  bool bmi2     = false;
+  bool popcnt   = false;
+
+  friend bool operator==(const cpu_features&, const cpu_features&) = default;
+};
+
+// The extensions this CPU supports, or without TIGHT_UINT_DISPATCH those the
+// build enables. pdep and pext are microcoded on AMD before Zen 3 and slower
+// than the shifts they replace, so BMI2 is reported missing there.
+inline cpu_features detect_cpu_features() {
+  cpu_features result;
+#if defined(TIGHT_UINT_DISPATCH)
+  __builtin_cpu_init();
+  result.sse41    = __builtin_cpu_supports("sse4.1");
+  result.avx2     = __builtin_cpu_supports("avx2");
+  result.avx512bw = __builtin_cpu_supports("avx512bw");
+  result.bmi2     = __builtin_cpu_supports("bmi2") &&
+                !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+  result.popcnt = __builtin_cpu_supports("popcnt");
+#else
+#if defined(__SSE4_1__)
+  result.sse41 = true;
+#endif
+#if defined(__AVX2__)
+  result.avx2 = true;
+#endif
+#if defined(__AVX512BW__)
+  result.avx512bw = true;
+#endif
+#if defined(__BMI2__)
+  result.bmi2 = true;
+#endif
+#if defined(__POPCNT__)
+  result.popcnt = true;
+#endif
+#endif
+  return result;
+}
+
+namespace detail {
+
+inline cpu_features& active_cpu_features() {
+  static cpu_features s_features = detect_cpu_features();
+  return s_features;
+}
+
+} // namespace detail
+
+// The extensions the bulk kernels use, detected once on first use
+inline const cpu_features& cpu() { return detail::active_cpu_features(); }
+
+// Limits the kernels to features, e.g. to compare them or to avoid one that is
+// slow on some CPU. Extensions the CPU lacks stay off. Not thread safe: call
+// it before other threads use the library.
+inline void set_cpu_features(const cpu_features& features) {
+  cpu_features detected = detect_cpu_features();
+  cpu_features& active  = detail::active_cpu_features();
+  active.sse41          = features.sse41 && detected.sse41;
+  active.avx2           = features.avx2 && detected.avx2;
+  active.avx512bw       = features.avx512bw && detected.avx512bw;
+  active.bmi2           = features.bmi2 && detected.bmi2;
+  active.popcnt         = features.popcnt && detected.popcnt;
+}
+
+} // namespace tight_uint
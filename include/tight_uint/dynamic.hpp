@@ -0,0 +1,516 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/tight_uint.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tight_uint {
+
+// Calls f(std::integral_constant<size_t, bits>{}) for a runtime bits, so
+// callers can instantiate compile time kernels once per call instead of once
+// per element. bits must be in [1, word bits of T).
+template <class T, class Function>
+decltype(auto) dispatch_bits(size_t bits, Function&& f) {
+  constexpr size_t s_bits = detail::word_bits<std::remove_const_t<T>>;
+  if (bits == 0 || bits >= s_bits)
+    throw std::invalid_argument("bits must be between 1 and word bits - 1");
+  return [&]<size_t... i>(std::index_sequence<i...>) -> decltype(auto) {
+    using result_type = decltype(f(std::integral_constant<size_t, 1>{}));
+    if constexpr (std::is_void_v<result_type>) {
+      ((bits == i + 1 ? (f(std::integral_constant<size_t, i + 1>{}), true)
+                      : false) ||
+       ...);
+    } else {
+      result_type result{};
+      ((bits == i + 1
+            ? (result = f(std::integral_constant<size_t, i + 1>{}), true)
+            : false) ||
+       ...);
+      return result;
+    }
+  }(std::make_index_sequence<s_bits - 1>());
+}
+
+// Reference wrapper for values with a runtime bit width. Unlike uint_value
+// the shifts are not constants, but there is no instantiation per width.
+template <class T>
+class dynamic_uint_value {
+public:
+  using value_type = std::remove_const_t<T>;
+  dynamic_uint_value()                                = delete;
+  dynamic_uint_value(const dynamic_uint_value& other) = delete;
+  dynamic_uint_value(T* words, size_t bit_offset, uint8_t bits)
+      : m_words(words), m_offset(bit_offset), m_bits(bits) {
+    static_assert(std::is_unsigned_v<value_type>,
+                  "signed types are not implemented");
+  }
+  const dynamic_uint_value& operator=(const value_type& value) const
+    requires(!std::is_const_v<T>)
+  {
+    T*         word  = m_words + m_offset / s_type_bits;
+    size_t     shift = m_offset % s_type_bits;
+    value_type mask  = mask_bits();
+    value_type v     = value & mask;
+    word[0] = static_cast<value_type>((word[0] & ~(mask << shift)) |
+                                      (v << shift));
+    if (shift + m_bits > s_type_bits) {
+      size_t next_shift = s_type_bits - shift;
+      word[1] = static_cast<value_type>((word[1] & ~(mask >> next_shift)) |
+                                        (v >> next_shift));
+    }
+    return *this;
+  }
+  operator value_type() const {
+    const T*   word   = m_words + m_offset / s_type_bits;
+    size_t     shift  = m_offset % s_type_bits;
+    value_type result = static_cast<value_type>(word[0] >> shift);
+    if (shift + m_bits > s_type_bits)
+      result |= static_cast<value_type>(word[1] << (s_type_bits - shift));
+    return result & mask_bits();
+  }
+
+  dynamic_uint_value& operator=(const dynamic_uint_value& other) {
+    *this = static_cast<value_type>(other);
+    return *this;
+  }
+
+private:
+  static constexpr size_t s_type_bits = sizeof(value_type) * 8;
+  value_type              mask_bits() const {
+    return static_cast<value_type>((value_type(1) << m_bits) - 1);
+  }
+  T*      m_words;
+  size_t  m_offset;
+  uint8_t m_bits;
+};
+
+template <class T>
+class dynamic_iterator {
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type        = std::remove_const_t<T>;
+  using reference         = dynamic_uint_value<T>;
+  using const_reference   = reference;
+  using difference_type   = std::ptrdiff_t;
+  using offset_type       = size_t;
+
+  dynamic_iterator() : m_words(nullptr), m_index(0), m_bits(0) {}
+  dynamic_iterator(T* words, offset_type index, uint8_t bits)
+      : m_words(words), m_index(index), m_bits(bits) {}
+
+  reference operator*() const {
+    return reference(m_words, m_index * m_bits, m_bits);
+  }
+  reference operator[](difference_type index) const {
+    return *(*this + index);
+  }
+
+  dynamic_iterator& operator++() {
+    ++m_index;
+    return *this;
+  }
+  dynamic_iterator operator++(int) {
+    dynamic_iterator temp = *this;
+    ++m_index;
+    return temp;
+  }
+  dynamic_iterator& operator--() {
+    --m_index;
+    return *this;
+  }
+  dynamic_iterator operator--(int) {
+    dynamic_iterator temp = *this;
+    --m_index;
+    return temp;
+  }
+  dynamic_iterator& operator+=(difference_type n) {
+    m_index += n;
+    return *this;
+  }
+  dynamic_iterator& operator-=(difference_type n) {
+    m_index -= n;
+    return *this;
+  }
+  dynamic_iterator operator+(difference_type n) const {
+    return dynamic_iterator(m_words, m_index + n, m_bits);
+  }
+  friend dynamic_iterator operator+(difference_type         n,
+                                    const dynamic_iterator& it) {
+    return it + n;
+  }
+  dynamic_iterator operator-(difference_type n) const {
+    return dynamic_iterator(m_words, m_index - n, m_bits);
+  }
+  difference_type operator-(const dynamic_iterator& other) const {
+    return static_cast<difference_type>(m_index) -
+           static_cast<difference_type>(other.m_index);
+  }
+
+  bool operator==(const dynamic_iterator& other) const {
+    return m_index == other.m_index;
+  }
+  bool operator!=(const dynamic_iterator& other) const {
+    return m_index != other.m_index;
+  }
+  bool operator<(const dynamic_iterator& other) const {
+    return m_index < other.m_index;
+  }
+  bool operator<=(const dynamic_iterator& other) const {
+    return m_index <= other.m_index;
+  }
+  bool operator>(const dynamic_iterator& other) const {
+    return m_index > other.m_index;
+  }
+  bool operator>=(const dynamic_iterator& other) const {
+    return m_index >= other.m_index;
+  }
+
+private:
+  T*          m_words;
+  offset_type m_index;
+  uint8_t     m_bits;
+};
+
+// View of existing data with the bit width chosen at runtime
+template <class T>
+class dynamic_span {
+public:
+  using iterator        = dynamic_iterator<T>;
+  using const_iterator  = iterator;
+  using value_type      = typename iterator::value_type;
+  using reference       = typename iterator::reference;
+  using const_reference = typename const_iterator::const_reference;
+  using size_type       = typename iterator::offset_type;
+  using difference_type = typename iterator::difference_type;
+
+  dynamic_span() {}
+  dynamic_span(size_t bits, std::span<T> words)
+      : dynamic_span(bits, words,
+                     words.size() * s_type_bits / checked_bits(bits)) {}
+  dynamic_span(size_t bits, std::span<T> words, size_type size)
+      : m_span(words), m_size(size), m_bits(checked_bits(bits)) {}
+  template <size_t bits>
+  dynamic_span(span<bits, T> other)
+      : dynamic_span(bits,
+                     std::span<T>(reinterpret_cast<T*>(other.data()),
+                                  other.size_bytes() / sizeof(T)),
+                     other.size()) {}
+
+  reference operator[](size_type index) const {
+    return reference(m_span.data(), index * m_bits, m_bits);
+  }
+
+  iterator begin() const { return iterator(m_span.data(), 0, m_bits); }
+  iterator end() const { return iterator(m_span.data(), m_size, m_bits); }
+
+  T*        words() const { return m_span.data(); }
+  size_type size_bytes() const { return m_span.size() * sizeof(value_type); }
+  size_type size() const { return m_size; }
+  size_t    bits() const { return m_bits; }
+
+  // Typed view for a known width. bits must match.
+  template <size_t bits>
+  span<bits, T> as() const {
+    return span<bits, T>(m_span, m_size);
+  }
+
+  // Calls f(span<bits, T>) with the width as a compile time constant
+  template <class Function>
+  decltype(auto) visit(Function&& f) const {
+    return dispatch_bits<T>(m_bits, [&](auto bits) {
+      return f(as<decltype(bits)::value>());
+    });
+  }
+
+private:
+  static constexpr size_t s_type_bits = sizeof(value_type) * 8;
+  static uint8_t          checked_bits(size_t bits) {
+    if (bits == 0 || bits >= s_type_bits)
+      throw std::invalid_argument("bits must be between 1 and word bits - 1");
+    return static_cast<uint8_t>(bits);
+  }
+
+  std::span<T> m_span;
+  size_type    m_size = 0;
+  uint8_t      m_bits = 1;
+};
+
+// Bulk operations. Each dispatches on the width once per call into the
+// compile time kernels.
+
+template <class T>
+void unpack(const dynamic_span<T>& range, size_t first,
+            std::span<std::remove_const_t<T>> out) {
+  range.visit([&](auto typed) { tight_uint::unpack(typed, first, out); });
+}
+
+template <class T>
+void pack(const dynamic_span<T>& range, size_t first,
+          std::type_identity_t<std::span<const T>> in) {
+  range.visit([&](auto typed) { tight_uint::pack(typed, first, in); });
+}
+
+template <class T>
+void fill(const dynamic_span<T>& range,
+          const std::type_identity_t<T>& value) {
+  range.visit([&](auto typed) {
+    tight_uint::fill(typed.begin(), typed.end(), value);
+  });
+}
+
+template <class T>
+void gather(const dynamic_span<T>& range, std::span<const size_t> indices,
+            std::span<std::remove_const_t<T>> out,
+            size_t prefetch_distance = default_prefetch_distance) {
+  range.visit([&](auto typed) {
+    tight_uint::gather(typed, indices, out, prefetch_distance);
+  });
+}
+
+template <class T, class... Args>
+void scatter(const dynamic_span<T>& range, std::span<const size_t> indices,
+             std::span<const std::remove_const_t<T>> values, Args... args) {
+  range.visit([&](auto typed) {
+    tight_uint::scatter(typed, indices, values, args...);
+  });
+}
+
+template <class T>
+uint64_t sum(const dynamic_span<T>& range) {
+  return range.visit([](auto typed) { return tight_uint::sum(typed); });
+}
+
+template <class T>
+std::ranges::min_max_result<std::remove_const_t<T>>
+min_max(const dynamic_span<T>& range) {
+  return range.visit([](auto typed) { return tight_uint::min_max(typed); });
+}
+
+template <class T>
+size_t count(const dynamic_span<T>& range,
+             const std::remove_const_t<T>& value) {
+  return range.visit(
+      [&](auto typed) { return tight_uint::count(typed, value); });
+}
+
+template <class T>
+void histogram(const dynamic_span<T>& range, std::span<size_t> counts) {
+  range.visit([&](auto typed) { tight_uint::histogram(typed, counts); });
+}
+
+// Runtime width transcode(). Dispatches on the input width and packs each
+// decoded block into out, so only one width is a template parameter.
+template <class T, class U>
+void transcode(const dynamic_span<T>& in, const dynamic_span<U>& out,
+               narrowing mode = narrowing::checked) {
+  if (out.size() < in.size())
+    throw std::invalid_argument("transcode destination is too small");
+  using in_type  = std::remove_const_t<T>;
+  in_type mask   = static_cast<in_type>((uint64_t(1) << out.bits()) - 1);
+  bool    narrow = out.bits() < in.bits();
+  in.visit([&](auto typed) {
+    std::array<in_type, 256> block;
+    std::array<U, 256>       converted;
+    for (size_t first = 0; first < typed.size(); first += block.size()) {
+      size_t count = std::min(block.size(), typed.size() - first);
+      tight_uint::unpack(typed, first, std::span(block.data(), count));
+      if (narrow) {
+        in_type high = 0;
+        for (size_t i = 0; i < count; ++i) {
+          high |= block[i];
+          block[i] &= mask;
+        }
+        if (mode == narrowing::checked && (high & ~mask))
+          throw std::out_of_range(
+              "value does not fit in the destination width");
+      }
+      std::copy_n(block.begin(), count, converted.begin());
+      tight_uint::pack(out, first,
+                       std::span<const U>(converted.data(), count));
+    }
+  });
+}
+
+// Folds all values with op, decoding in blocks with the bulk kernels
+template <class T, class U, class BinaryOperation = std::plus<>>
+U reduce(const dynamic_span<T>& range, U init, BinaryOperation op = {}) {
+  return range.visit([&](auto typed) {
+    std::array<std::remove_const_t<T>, 256> block;
+    U                                       result = init;
+    for (size_t first = 0; first < typed.size(); first += block.size()) {
+      size_t count = std::min(block.size(), typed.size() - first);
+      tight_uint::unpack(typed, first, std::span(block.data(), count));
+      result = std::accumulate(block.begin(), block.begin() + count, result,
+                               op);
+    }
+    return result;
+  });
+}
+
+// std::vector backed array with the bit width chosen at runtime
+template <class T = uint32_t>
+class dynamic_vector {
+public:
+  using iterator        = dynamic_iterator<T>;
+  using const_iterator  = dynamic_iterator<const T>;
+  using value_type      = typename iterator::value_type;
+  using reference       = typename iterator::reference;
+  using const_reference = typename const_iterator::const_reference;
+  using size_type       = typename iterator::offset_type;
+  using difference_type = typename iterator::difference_type;
+
+  explicit dynamic_vector(size_t bits) : m_bits(checked_bits(bits)) {}
+  dynamic_vector(size_t bits, size_type size)
+      : m_bits(checked_bits(bits)),
+        m_container(required_base_elements(size)), m_size(size) {}
+  dynamic_vector(size_t bits, size_type size, const value_type& init)
+      : dynamic_vector(bits, size) {
+    tight_uint::fill(view(), init);
+  }
+  dynamic_vector(size_t bits, std::span<const value_type> values)
+      : dynamic_vector(bits, values.size()) {
+    tight_uint::pack(view(), 0, values);
+  }
+
+  reference operator[](size_type index) {
+    return reference(m_container.data(), index * m_bits, m_bits);
+  }
+  const_reference operator[](size_type index) const {
+    return const_reference(m_container.data(), index * m_bits, m_bits);
+  }
+
+  iterator begin() { return iterator(m_container.data(), 0, m_bits); }
+  const_iterator begin() const {
+    return const_iterator(m_container.data(), 0, m_bits);
+  }
+  iterator end() { return iterator(m_container.data(), m_size, m_bits); }
+  const_iterator end() const {
+    return const_iterator(m_container.data(), m_size, m_bits);
+  }
+
+  dynamic_span<T>       view() { return {m_bits, m_container, m_size}; }
+  dynamic_span<const T> view() const {
+    return {m_bits, std::span<const T>(m_container), m_size};
+  }
+
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(m_container.data()); }
+  const uint8_t* data() const {
+    return reinterpret_cast<const uint8_t*>(m_container.data());
+  }
+  size_type size_bytes() const {
+    return m_container.size() * sizeof(value_type);
+  }
+  size_type size() const { return m_size; }
+  size_t    bits() const { return m_bits; }
+
+  size_type capacity() const {
+    return (m_container.capacity() * s_type_bits) / m_bits;
+  }
+  void resize(size_type size) {
+    size_type words = required_base_elements(size);
+    // Clear bits past the end so growing again reads zeros
+    if (size < m_size && (size * m_bits) % s_type_bits)
+      m_container[words - 1] &= static_cast<T>(
+          (T(1) << (size * m_bits) % s_type_bits) - 1);
+    m_container.resize(words);
+    m_size = size;
+  }
+  void reserve(size_type capacity) {
+    m_container.reserve(required_base_elements(capacity));
+  }
+  void push_back(const value_type& value) {
+    resize(m_size + 1);
+    (*this)[m_size - 1] = value;
+  }
+
+private:
+  static constexpr size_t s_type_bits = sizeof(value_type) * 8;
+  static uint8_t          checked_bits(size_t bits) {
+    if (bits == 0 || bits >= s_type_bits)
+      throw std::invalid_argument("bits must be between 1 and word bits - 1");
+    return static_cast<uint8_t>(bits);
+  }
+  size_type required_base_elements(size_type size) const {
+    // Round up
+    return (size * m_bits + s_type_bits - 1) / s_type_bits;
+  }
+
+  uint8_t        m_bits;
+  std::vector<T> m_container;
+  size_type      m_size = 0;
+};
+
+// Vector overloads
+
+template <class T>
+void unpack(const dynamic_vector<T>& range, size_t first,
+            std::type_identity_t<std::span<T>> out) {
+  unpack(range.view(), first, out);
+}
+
+template <class T>
+void pack(dynamic_vector<T>& range, size_t first,
+          std::type_identity_t<std::span<const T>> in) {
+  pack(range.view(), first, in);
+}
+
+template <class T>
+void fill(dynamic_vector<T>& range, const std::type_identity_t<T>& value) {
+  fill(range.view(), value);
+}
+
+template <class T>
+void gather(const dynamic_vector<T>& range, std::span<const size_t> indices,
+            std::type_identity_t<std::span<T>> out,
+            size_t prefetch_distance = default_prefetch_distance) {
+  gather(range.view(), indices, out, prefetch_distance);
+}
+
+template <class T, class... Args>
+void scatter(dynamic_vector<T>& range, std::span<const size_t> indices,
+             std::type_identity_t<std::span<const T>> values, Args... args) {
+  scatter(range.view(), indices, values, args...);
+}
+
+template <class T>
+uint64_t sum(const dynamic_vector<T>& range) {
+  return sum(range.view());
+}
+
+template <class T>
+std::ranges::min_max_result<T> min_max(const dynamic_vector<T>& range) {
+  return min_max(range.view());
+}
+
+template <class T>
+size_t count(const dynamic_vector<T>& range,
+             const std::type_identity_t<T>& value) {
+  return count(range.view(), value);
+}
+
+template <class T>
+void histogram(const dynamic_vector<T>& range, std::span<size_t> counts) {
+  histogram(range.view(), counts);
+}
+
+template <class T, class U>
+void transcode(const dynamic_vector<T>& in, dynamic_vector<U>& out,
+               narrowing mode = narrowing::checked) {
+  transcode(in.view(), out.view(), mode);
+}
+
+template <class T, class U, class BinaryOperation = std::plus<>>
+U reduce(const dynamic_vector<T>& range, U init, BinaryOperation op = {}) {
+  return reduce(range.view(), init, op);
+}
+
+} // namespace tight_uint
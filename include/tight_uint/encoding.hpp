@@ -0,0 +1,224 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/cpu.hpp>
+#include <tight_uint/dynamic.hpp>
+#include <vector>
+
+namespace tight_uint {
+
+namespace detail {
+
+// Packed width needed for values up to max_value
+template <class T>
+size_t required_bits(T max_value) {
+  size_t bits = std::max<size_t>(1, std::bit_width(max_value));
+  if (bits >= word_bits<T>)
+    throw std::invalid_argument("value range needs every bit of the word type");
+  return bits;
+}
+
+// values[i] += base
+template <class T>
+void add_base(T* values, size_t count, T base) {
+  // Simple enough for compilers to vectorize
+  for (size_t i = 0; i < count; ++i)
+    values[i] += base;
+}
+
+#if defined(TIGHT_UINT_SSE41)
+
+// Log-step scan within four lanes, then add the running total. Returns the
+// number of values done and updates carry.
+TIGHT_UINT_TARGET("sse4.1")
+inline size_t prefix_sum_sse41(uint32_t* values, size_t count,
+                               uint32_t& carry) {
+  size_t  i     = 0;
+  __m128i total = _mm_set1_epi32(static_cast<int>(carry));
+  for (; i + 4 <= count; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    x         = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x         = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    x         = _mm_add_epi32(x, total);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), x);
+    total = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  carry = static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+  return i;
+}
+
+#endif
+
+// Inclusive prefix sum, starting from carry. Returns the last value.
+template <class T>
+T prefix_sum(T* values, size_t count, T carry) {
+  size_t i = 0;
+#if defined(TIGHT_UINT_SSE41)
+  if constexpr (std::is_same_v<T, uint32_t>)
+    if (cpu().sse41)
+      i = prefix_sum_sse41(values, count, carry);
+#endif
+  for (; i < count; ++i)
+    values[i] = carry = static_cast<T>(carry + values[i]);
+  return carry;
+}
+
+} // namespace detail
+
+// Frame of reference encoding. Stores the minimum value once and packs each
+// value's offset from it, with the width chosen from the input's range.
+// Packed widths are below the word size, so the constructor throws
+// std::invalid_argument if the range needs every bit of T, e.g. {0, 0xffffffff}
+// with uint32_t. Use a wider T for such columns.
+template <class T = uint32_t>
+class frame_of_reference {
+public:
+  using value_type = T;
+  using size_type  = size_t;
+
+  frame_of_reference() : m_offsets(1) {}
+  explicit frame_of_reference(std::span<const T> values)
+      : m_base(values.empty() ? T(0) : *std::ranges::min_element(values)),
+        m_offsets(values.empty()
+                      ? 1
+                      : detail::required_bits<T>(
+                            *std::ranges::max_element(values) - m_base),
+                  values.size()) {
+    std::array<T, 256> block;
+    for (size_t first = 0; first < values.size(); first += block.size()) {
+      size_t count = std::min(block.size(), values.size() - first);
+      for (size_t i = 0; i < count; ++i)
+        block[i] = static_cast<T>(values[first + i] - m_base);
+      tight_uint::pack(m_offsets, first, std::span(block.data(), count));
+    }
+  }
+
+  value_type operator[](size_type index) const {
+    return static_cast<T>(m_base + m_offsets[index]);
+  }
+
+  // Decodes out.size() values starting at index first
+  void unpack(size_type first, std::span<T> out) const {
+    tight_uint::unpack(m_offsets, first, out);
+    detail::add_base(out.data(), out.size(), m_base);
+  }
+
+  std::vector<T> decode() const {
+    std::vector<T> result(size());
+    unpack(0, result);
+    return result;
+  }
+
+  value_type base() const { return m_base; }
+  size_t     bits() const { return m_offsets.bits(); }
+  size_type  size() const { return m_offsets.size(); }
+  size_type  size_bytes() const { return m_offsets.size_bytes() + sizeof(T); }
+  const dynamic_vector<T>& offsets() const { return m_offsets; }
+
+private:
+  T                 m_base = 0;
+  dynamic_vector<T> m_offsets;
+};
+
+// Delta encoding for non-decreasing values, e.g. sorted IDs or timestamps.
+// Packs the difference from the previous value. Every block_size values an
+// absolute checkpoint is stored so random access decodes at most one block.
+// As with frame_of_reference, a delta needing every bit of T throws
+// std::invalid_argument.
+template <class T = uint32_t>
+class delta_vector {
+public:
+  using value_type = T;
+  using size_type  = size_t;
+
+  static constexpr size_type default_block_size = 128;
+
+  delta_vector() : m_deltas(1) {}
+  explicit delta_vector(std::span<const T> values,
+                        size_type          block_size = default_block_size)
+      : m_block_size(block_size), m_deltas(1) {
+    if (block_size == 0)
+      throw std::invalid_argument("block_size must not be zero");
+    T max_delta = 0;
+    for (size_t i = 1; i < values.size(); ++i) {
+      if (values[i] < values[i - 1])
+        throw std::invalid_argument("values must be non-decreasing");
+      if (i % block_size != 0)
+        max_delta =
+            std::max(max_delta, static_cast<T>(values[i] - values[i - 1]));
+    }
+    m_deltas = dynamic_vector<T>(detail::required_bits<T>(max_delta),
+                                 values.size());
+    m_checkpoints.reserve((values.size() + block_size - 1) / block_size);
+
+    // Checkpoints store a zero delta so block decoding is a plain scan
+    std::vector<T> block(block_size);
+    for (size_t first = 0; first < values.size(); first += block_size) {
+      size_t count = std::min(block_size, values.size() - first);
+      m_checkpoints.push_back(values[first]);
+      block[0] = 0;
+      for (size_t i = 1; i < count; ++i)
+        block[i] = static_cast<T>(values[first + i] - values[first + i - 1]);
+      tight_uint::pack(m_deltas, first, std::span(block.data(), count));
+    }
+  }
+
+  // Decodes up to one block
+  value_type operator[](size_type index) const {
+    size_type block_first = index - index % m_block_size;
+    T         result      = m_checkpoints[index / m_block_size];
+    for (size_type i = block_first + 1; i <= index; ++i)
+      result = static_cast<T>(result + m_deltas[i]);
+    return result;
+  }
+
+  // Decodes out.size() values starting at index first. The deltas are
+  // unpacked in bulk and then prefix summed from each block's checkpoint.
+  void unpack(size_type first, std::span<T> out) const {
+    if (out.empty())
+      return;
+    tight_uint::unpack(m_deltas, first, out);
+    size_type offset = first % m_block_size;
+    T         carry  = (*this)[first];
+    out[0]           = carry;
+    for (size_type i = 1; i < out.size();) {
+      size_type block_offset = (offset + i) % m_block_size;
+      if (block_offset == 0) {
+        // Restart from the checkpoint
+        carry  = m_checkpoints[(first + i) / m_block_size];
+        out[i] = carry;
+        ++i;
+        continue;
+      }
+      size_type count = std::min(m_block_size - block_offset, out.size() - i);
+      carry           = detail::prefix_sum(out.data() + i, count, carry);
+      i += count;
+    }
+  }
+
+  std::vector<T> decode() const {
+    std::vector<T> result(size());
+    unpack(0, result);
+    return result;
+  }
+
+  size_t    bits() const { return m_deltas.bits(); }
+  size_type block_size() const { return m_block_size; }
+  size_type size() const { return m_deltas.size(); }
+  size_type size_bytes() const {
+    return m_deltas.size_bytes() + m_checkpoints.size() * sizeof(T);
+  }
+
+private:
+  size_type         m_block_size = default_block_size;
+  std::vector<T>    m_checkpoints;
+  dynamic_vector<T> m_deltas;
+};
+
+} // namespace tight_uint
@@ -0,0 +1,253 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/dynamic.hpp>
+#include <tight_uint/tight_uint.hpp>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TIGHT_UINT_HAS_MMAP 1
+#endif
+
+namespace tight_uint {
+
+// On-disk layout: this header, zero padding up to data_offset, then the
+// packed words exactly as they are in memory. Words are stored in native byte
+// order, which byte_order records so a mismatched file is rejected rather
+// than misread.
+struct file_header {
+  static constexpr char     s_magic[8]    = {'T', 'I', 'G', 'H',
+                                             'T', 'U', 'I', 'N'};
+  static constexpr uint32_t s_version     = 1;
+  static constexpr uint32_t s_byte_order  = 0x01020304;
+  static constexpr uint64_t s_data_offset = 64;
+
+  char     magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t bits;
+  uint32_t word_bytes;
+  uint64_t size;        // number of values
+  uint64_t data_offset; // from the start of the file, a multiple of 64
+  uint64_t data_bytes;
+
+  template <class T>
+  static file_header make(size_t bits, size_t size, size_t data_bytes) {
+    file_header header{};
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version     = s_version;
+    header.byte_order  = s_byte_order;
+    header.bits        = static_cast<uint32_t>(bits);
+    header.word_bytes  = sizeof(T);
+    header.size        = size;
+    header.data_offset = s_data_offset;
+    header.data_bytes  = data_bytes;
+    return header;
+  }
+
+  // Throws if the header is not a supported file with T words. bits of zero
+  // accepts any width.
+  template <class T>
+  void validate(size_t expected_bits = 0) const {
+    if (std::memcmp(magic, s_magic, sizeof(s_magic)) != 0)
+      throw std::runtime_error("not a tight_uint file");
+    if (version != s_version)
+      throw std::runtime_error("unsupported tight_uint file version");
+    if (byte_order != s_byte_order)
+      throw std::runtime_error("tight_uint file has a different byte order");
+    if (word_bytes != sizeof(T))
+      throw std::runtime_error("tight_uint file has a different word type");
+    if (bits == 0 || bits >= word_bytes * 8 ||
+        (expected_bits != 0 && bits != expected_bits))
+      throw std::runtime_error("tight_uint file has a different bit width");
+    // size * bits may overflow, so compare against the most values that fit
+    if (size > data_bytes / bits * 8 + data_bytes % bits * 8 / bits ||
+        data_bytes % word_bytes != 0 || data_offset < sizeof(file_header) ||
+        data_offset % s_data_offset != 0)
+      throw std::runtime_error("corrupt tight_uint file header");
+  }
+};
+static_assert(sizeof(file_header) <= file_header::s_data_offset);
+
+namespace detail {
+
+template <class T>
+void write_packed(std::ostream& out, size_t bits, size_t size,
+                  const uint8_t* data, size_t size_bytes) {
+  file_header header = file_header::make<T>(bits, size, size_bytes);
+  char        padded[file_header::s_data_offset]{};
+  std::memcpy(padded, &header, sizeof(header));
+  out.write(padded, sizeof(padded));
+  out.write(reinterpret_cast<const char*>(data),
+            static_cast<std::streamsize>(size_bytes));
+  if (!out)
+    throw std::runtime_error("failed to write tight_uint file");
+}
+
+// Reads and validates the header, leaving the stream at the data
+template <class T>
+file_header read_header(std::istream& in, size_t expected_bits) {
+  file_header header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    throw std::runtime_error("failed to read tight_uint file header");
+  header.validate<T>(expected_bits);
+  in.ignore(static_cast<std::streamsize>(header.data_offset - sizeof(header)));
+  return header;
+}
+
+} // namespace detail
+
+// Writes the header then the packed words in one write
+template <size_t bits, class T, class Allocator>
+void write(std::ostream& out, const vector<bits, T, Allocator>& range) {
+  detail::write_packed<T>(out, bits, range.size(), range.data(),
+                          range.size_bytes());
+}
+
+template <size_t bits, class T>
+void write(std::ostream& out, const span<bits, T>& range) {
+  detail::write_packed<std::remove_const_t<T>>(out, bits, range.size(),
+                                               range.data(),
+                                               range.size_bytes());
+}
+
+template <class T>
+void write(std::ostream& out, const dynamic_vector<T>& range) {
+  detail::write_packed<T>(out, range.bits(), range.size(), range.data(),
+                          range.size_bytes());
+}
+
+template <class Range>
+void write(const std::filesystem::path& path, const Range& range) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    throw std::runtime_error("failed to open " + path.string());
+  write(out, range);
+}
+
+// Reads a whole file into a vector with a single read of the words
+template <size_t bits, class T = uint32_t>
+vector<bits, T> read(std::istream& in) {
+  file_header header = detail::read_header<T>(in, bits);
+  vector<bits, T> result(header.size);
+  if (!in.read(reinterpret_cast<char*>(result.data()),
+               static_cast<std::streamsize>(result.size_bytes())))
+    throw std::runtime_error("failed to read tight_uint file data");
+  return result;
+}
+
+template <size_t bits, class T = uint32_t>
+vector<bits, T> read(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("failed to open " + path.string());
+  return read<bits, T>(in);
+}
+
+#ifdef TIGHT_UINT_HAS_MMAP
+
+// RAII memory mapping of a whole tight_uint file. Writable mappings are
+// shared, so writes go to the page cache and the file.
+class mapped_file {
+public:
+  mapped_file() = default;
+  mapped_file(const std::filesystem::path& path, bool writable) {
+    int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("failed to open " + path.string());
+    struct stat info;
+    if (::fstat(fd, &info) != 0 ||
+        static_cast<size_t>(info.st_size) < sizeof(file_header)) {
+      ::close(fd);
+      throw std::runtime_error("not a tight_uint file: " + path.string());
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* address = ::mmap(nullptr, m_size, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+      throw std::runtime_error("failed to map " + path.string());
+    m_address = static_cast<uint8_t*>(address);
+    // Compared without adding, which could overflow
+    if (header().data_offset > m_size ||
+        header().data_bytes > m_size - header().data_offset) {
+      unmap();
+      throw std::runtime_error("truncated tight_uint file: " + path.string());
+    }
+  }
+  mapped_file(const mapped_file& other) = delete;
+  mapped_file(mapped_file&& other) noexcept
+      : m_address(std::exchange(other.m_address, nullptr)),
+        m_size(std::exchange(other.m_size, 0)) {}
+  mapped_file& operator=(const mapped_file& other) = delete;
+  mapped_file& operator=(mapped_file&& other) noexcept {
+    unmap();
+    m_address = std::exchange(other.m_address, nullptr);
+    m_size    = std::exchange(other.m_size, 0);
+    return *this;
+  }
+  ~mapped_file() { unmap(); }
+
+  const file_header& header() const {
+    return *reinterpret_cast<const file_header*>(m_address);
+  }
+
+  // The packed words, validated against T and bits
+  template <class T>
+  std::span<T> packed_words(size_t bits = 0) const {
+    header().validate<std::remove_const_t<T>>(bits);
+    return std::span<T>(reinterpret_cast<T*>(m_address + header().data_offset),
+                        header().data_bytes / sizeof(T));
+  }
+
+private:
+  void unmap() {
+    if (m_address)
+      ::munmap(m_address, m_size);
+    m_address = nullptr;
+  }
+
+  uint8_t* m_address = nullptr;
+  size_t   m_size    = 0;
+};
+
+// A span over a memory mapped tight_uint file. Opening costs one mmap with no
+// copy or parse step; pages are loaded on first access. Use a const T for a
+// read-only mapping.
+template <size_t bits, class T>
+class mapped_span : private mapped_file, public span<bits, T> {
+public:
+  explicit mapped_span(const std::filesystem::path& path)
+      : mapped_file(path, !std::is_const_v<T>),
+        span<bits, T>(mapped_file::packed_words<T>(bits), header().size) {}
+
+  using mapped_file::header;
+};
+
+// Runtime width equivalent of mapped_span
+template <class T>
+class mapped_dynamic_span : private mapped_file, public dynamic_span<T> {
+public:
+  explicit mapped_dynamic_span(const std::filesystem::path& path)
+      : mapped_file(path, !std::is_const_v<T>),
+        dynamic_span<T>(header().bits, mapped_file::packed_words<T>(),
+                        header().size) {}
+
+  using mapped_file::header;
+};
+
+#endif
+
+} // namespace tight_uint
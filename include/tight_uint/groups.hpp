@@ -0,0 +1,148 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <array>
+#include <ranges>
+#include <tight_uint/tight_uint.hpp>
+
+namespace tight_uint {
+
+// A whole repetition of the packing pattern: group_values values filling
+// exactly group_words words. Every offset is a compile time constant, so
+// decoding and encoding are unrolled without per-value branches.
+template <size_t bits, class T>
+class group {
+public:
+  using word_type  = std::remove_const_t<T>;
+  using value_type = word_type;
+  static constexpr size_t size  = detail::group_values<bits, word_type>;
+  static constexpr size_t words = detail::group_words<bits, word_type>;
+  using values_type             = std::array<value_type, size>;
+
+  constexpr explicit group(T* words) : m_words(words) {}
+
+  template <size_t i>
+  constexpr value_type get() const {
+    return detail::unpack_group_value<bits, word_type, i>(m_words);
+  }
+
+  constexpr values_type values() const {
+    values_type result;
+    detail::unpack_group<bits>(const_cast<const word_type*>(m_words),
+                               result.data());
+    return result;
+  }
+
+  // Overwrites all words of the group
+  constexpr void assign(const values_type& values) const
+    requires(!std::is_const_v<T>)
+  {
+    detail::pack_group<bits>(m_words, values.data());
+  }
+
+  // Calls f(value) for each value in order
+  template <class Function>
+  constexpr void for_each(Function&& f) const {
+    for_each(f, std::make_index_sequence<size>());
+  }
+
+  // Replaces each value with f(value)
+  template <class Function>
+  constexpr void transform(Function&& f) const
+    requires(!std::is_const_v<T>)
+  {
+    values_type result = values();
+    for (auto& value : result)
+      value = static_cast<value_type>(f(value));
+    assign(result);
+  }
+
+  constexpr T* data() const { return m_words; }
+
+private:
+  template <class Function, size_t... i>
+  constexpr void for_each(Function& f, std::index_sequence<i...>) const {
+    (f(get<i>()), ...);
+  }
+
+  T* m_words;
+};
+
+// Splits a packed range into a partial head, whole groups and a partial tail.
+// The head and tail are ordinary packed iterator ranges. For a whole vector or
+// span the head is always empty since they begin on a word boundary.
+template <size_t bits, class T>
+class group_view {
+public:
+  using group_type = group<bits, T>;
+  using iterator   = typename span<bits, T>::iterator;
+  using subrange   = std::ranges::subrange<iterator>;
+
+  group_view(span<bits, T> range, size_t first, size_t last)
+      : m_range(range), m_first(first), m_last(last),
+        m_group_first(std::min(
+            (first + group_type::size - 1) / group_type::size,
+            last / group_type::size)),
+        m_group_last(std::max(m_group_first, last / group_type::size)),
+        m_groups(std::views::iota(m_group_first, m_group_last),
+                 make_group{reinterpret_cast<T*>(range.data())}) {}
+  explicit group_view(span<bits, T> range)
+      : group_view(range, 0, range.size()) {}
+
+  subrange head() const {
+    size_t end = std::min(m_last, m_group_first * group_type::size);
+    end        = std::max(end, m_first);
+    return subrange(m_range.begin() + m_first, m_range.begin() + end);
+  }
+  subrange tail() const {
+    size_t first = std::max(m_first, m_group_last * group_type::size);
+    return subrange(m_range.begin() + first, m_range.begin() + m_last);
+  }
+
+  // Whole groups as a random access range
+  auto       begin() const { return m_groups.begin(); }
+  auto       end() const { return m_groups.end(); }
+  size_t     size() const { return m_groups.size(); }
+  group_type operator[](size_t index) const { return m_groups[index]; }
+
+private:
+  struct make_group {
+    T*         words;
+    group_type operator()(size_t index) const {
+      return group_type(words + index * group_type::words);
+    }
+  };
+  using groups_type =
+      std::ranges::transform_view<std::ranges::iota_view<size_t, size_t>,
+                                  make_group>;
+
+  span<bits, T> m_range;
+  size_t        m_first;
+  size_t        m_last;
+  size_t        m_group_first;
+  size_t        m_group_last;
+  groups_type   m_groups;
+};
+
+template <size_t bits, class T>
+group_view<bits, T> groups(span<bits, T> range) {
+  return group_view<bits, T>(range);
+}
+
+template <size_t bits, class T>
+group_view<bits, T> groups(span<bits, T> range, size_t first, size_t last) {
+  return group_view<bits, T>(range, first, last);
+}
+
+template <size_t bits, class T, class Allocator>
+group_view<bits, T> groups(vector<bits, T, Allocator>& range) {
+  return group_view<bits, T>(span<bits, T>(range));
+}
+
+template <size_t bits, class T, class Allocator>
+group_view<bits, const T> groups(const vector<bits, T, Allocator>& range) {
+  return group_view<bits, const T>(span<bits, const T>(range));
+}
+
+} // namespace tight_uint
@@ -0,0 +1,232 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include <tight_uint/sort.hpp>
+#include <tight_uint/tight_uint.hpp>
+#include <vector>
+
+namespace tight_uint {
+
+// Sub-ranges may only start at a multiple of chunk_alignment values. These
+// indices land on a word boundary, so no two chunks share a word.
+template <size_t bits, class T>
+constexpr size_t chunk_alignment =
+    detail::group_values<bits, std::remove_const_t<T>>;
+
+namespace detail {
+
+// [first, last) index pairs for up to n chunks, each starting at a multiple
+// of alignment. n == 0 is treated as 1.
+inline std::vector<std::pair<size_t, size_t>>
+chunk_bounds(size_t size, size_t alignment, size_t n) {
+  std::vector<std::pair<size_t, size_t>> result;
+  n                = std::max<size_t>(n, 1);
+  size_t groups    = (size + alignment - 1) / alignment;
+  size_t per_chunk = (groups + n - 1) / n;
+  size_t step      = std::max<size_t>(1, per_chunk) * alignment;
+  for (size_t first = 0; first < size; first += step)
+    result.emplace_back(first, std::min(size, first + step));
+  return result;
+}
+
+// View of [first, last). first must be a multiple of chunk_alignment.
+template <size_t bits, class T>
+span<bits, T> subspan(span<bits, T> range, size_t first, size_t last) {
+  constexpr size_t s_bits = word_bits<std::remove_const_t<T>>;
+  T*     words = reinterpret_cast<T*>(range.data()) + first * bits / s_bits;
+  size_t count = ((last - first) * bits + s_bits - 1) / s_bits;
+  return span<bits, T>(std::span<T>(words, count), last - first);
+}
+
+// Enough chunks to balance load without making them too small to matter
+inline size_t default_chunk_count(size_t size) {
+  constexpr size_t s_min_chunk = 16384;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  return std::max<size_t>(1, std::min(threads * 4, size / s_min_chunk));
+}
+
+} // namespace detail
+
+// Splits a packed range into at most n non-overlapping views that each start
+// on a word boundary, so they may be written concurrently without atomics.
+// n == 0 gives one chunk.
+template <size_t bits, class T>
+std::vector<span<bits, T>> chunks(span<bits, T> range, size_t n) {
+  std::vector<span<bits, T>> result;
+  for (auto [first, last] :
+       detail::chunk_bounds(range.size(), chunk_alignment<bits, T>, n))
+    result.push_back(detail::subspan(range, first, last));
+  return result;
+}
+
+template <size_t bits, class T, class Allocator>
+std::vector<span<bits, T>> chunks(vector<bits, T, Allocator>& range,
+                                  size_t                      n) {
+  return chunks(span<bits, T>(range), n);
+}
+
+template <size_t bits, class T, class Allocator>
+std::vector<span<bits, const T>>
+chunks(const vector<bits, T, Allocator>& range, size_t n) {
+  return chunks(span<bits, const T>(range), n);
+}
+
+// Standard algorithms, run over chunks() with an execution policy. Passing
+// packed iterators directly to e.g. std::fill(std::execution::par, ...) is a
+// data race because neighbouring values share words.
+namespace parallel {
+
+template <class ExecutionPolicy, size_t bits, class T, class Function>
+void for_each(ExecutionPolicy&& policy, span<bits, T> range, Function f) {
+  auto parts = chunks(range, detail::default_chunk_count(range.size()));
+  std::for_each(std::forward<ExecutionPolicy>(policy), parts.begin(),
+                parts.end(), [&f](span<bits, T>& part) {
+                  std::for_each(part.begin(), part.end(), f);
+                });
+}
+
+template <class ExecutionPolicy, size_t bits, class T>
+void fill(ExecutionPolicy&& policy, span<bits, T> range,
+          const std::remove_const_t<T>& value) {
+  auto parts = chunks(range, detail::default_chunk_count(range.size()));
+  std::for_each(std::forward<ExecutionPolicy>(policy), parts.begin(),
+                parts.end(), [&value](span<bits, T>& part) {
+                  tight_uint::fill(part.begin(), part.end(), value);
+                });
+}
+
+// Writes op(in[i]) to out[i]. The input may have any width or layout; the
+// output decides the split.
+template <class ExecutionPolicy, class InputRange, size_t bits, class T,
+          class UnaryOperation>
+void transform(ExecutionPolicy&& policy, const InputRange& in,
+               span<bits, T> out, UnaryOperation op) {
+  auto bounds =
+      detail::chunk_bounds(out.size(), chunk_alignment<bits, T>,
+                           detail::default_chunk_count(out.size()));
+  std::for_each(std::forward<ExecutionPolicy>(policy), bounds.begin(),
+                bounds.end(), [&](const std::pair<size_t, size_t>& bound) {
+                  auto part = detail::subspan(out, bound.first, bound.second);
+                  auto src  = in.begin() + bound.first;
+                  std::transform(src, src + part.size(), part.begin(), op);
+                });
+}
+
+template <class ExecutionPolicy, size_t bits, class T, class U,
+          class BinaryOperation = std::plus<>>
+U reduce(ExecutionPolicy&& policy, span<bits, T> range, U init,
+         BinaryOperation op = {}) {
+  auto parts = chunks(range, detail::default_chunk_count(range.size()));
+  return std::transform_reduce(
+      std::forward<ExecutionPolicy>(policy), parts.begin(), parts.end(), init,
+      op, [&op](const span<bits, T>& part) {
+        auto first  = part.begin();
+        U    result = *first;
+        return std::accumulate(++first, part.end(), result, op);
+      });
+}
+
+// Parallel tight_uint::sort(). Counting sorts count in parallel parts and then
+// write the runs for each chunk. Radix sorts decode, run each pass and encode
+// in parallel parts.
+template <class ExecutionPolicy, size_t bits, class T>
+void sort(ExecutionPolicy&& policy, span<bits, T> range) {
+  using value_type = std::remove_const_t<T>;
+  size_t size      = range.size();
+  auto   bounds    = detail::chunk_bounds(size, chunk_alignment<bits, T>,
+                                          detail::default_chunk_count(size));
+  if (bounds.size() <= 1) {
+    tight_uint::sort(range);
+    return;
+  }
+  auto parallel_for = [&policy](size_t n, auto&& f) {
+    std::vector<size_t> parts(n);
+    std::iota(parts.begin(), parts.end(), size_t(0));
+    std::for_each(policy, parts.begin(), parts.end(),
+                  [&f](size_t part) { f(part); });
+  };
+
+  if (detail::use_counting_sort<bits>(size)) {
+    // One set of counters per thread rather than per chunk
+    size_t values = size_t(1) << bits;
+    size_t parts  = std::min<size_t>(
+        bounds.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::vector<size_t>> counts(parts,
+                                            std::vector<size_t>(values));
+    parallel_for(parts, [&](size_t part) {
+      auto [first, last] = detail::part_bounds(size, part, parts);
+      detail::count_values(range, first, last, counts[part].data());
+    });
+    std::vector<size_t> starts(values + 1);
+    for (auto& part : counts)
+      std::transform(part.begin(), part.end(), starts.begin() + 1,
+                     starts.begin() + 1, std::plus<>());
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+    parallel_for(bounds.size(), [&](size_t i) {
+      detail::write_runs(range, bounds[i].first, bounds[i].second,
+                         starts.data(), values);
+    });
+    return;
+  }
+
+  std::vector<value_type> keys(size);
+  std::vector<value_type> scratch(size);
+  parallel_for(bounds.size(), [&](size_t i) {
+    auto [first, last] = bounds[i];
+    tight_uint::unpack(range, first, std::span(keys.data() + first,
+                                               last - first));
+  });
+  const value_type* sorted = detail::radix_sort<bits>(
+      keys.data(), scratch.data(), size, bounds.size(), parallel_for);
+  parallel_for(bounds.size(), [&](size_t i) {
+    auto [first, last] = bounds[i];
+    tight_uint::pack(range, first, std::span(sorted + first, last - first));
+  });
+}
+
+// Overloads taking a vector directly
+
+template <class ExecutionPolicy, size_t bits, class T, class Allocator,
+          class Function>
+void for_each(ExecutionPolicy&& policy, vector<bits, T, Allocator>& range,
+              Function f) {
+  parallel::for_each(std::forward<ExecutionPolicy>(policy),
+                     span<bits, T>(range), f);
+}
+
+template <class ExecutionPolicy, size_t bits, class T, class Allocator>
+void fill(ExecutionPolicy&& policy, vector<bits, T, Allocator>& range,
+          const T& value) {
+  parallel::fill(std::forward<ExecutionPolicy>(policy), span<bits, T>(range),
+                 value);
+}
+
+template <class ExecutionPolicy, class InputRange, size_t bits, class T,
+          class Allocator, class UnaryOperation>
+void transform(ExecutionPolicy&& policy, const InputRange& in,
+               vector<bits, T, Allocator>& out, UnaryOperation op) {
+  parallel::transform(std::forward<ExecutionPolicy>(policy), in,
+                      span<bits, T>(out), op);
+}
+
+template <class ExecutionPolicy, size_t bits, class T, class Allocator>
+void sort(ExecutionPolicy&& policy, vector<bits, T, Allocator>& range) {
+  parallel::sort(std::forward<ExecutionPolicy>(policy), span<bits, T>(range));
+}
+
+template <class ExecutionPolicy, size_t bits, class T, class Allocator,
+          class U, class BinaryOperation = std::plus<>>
+U reduce(ExecutionPolicy&& policy, const vector<bits, T, Allocator>& range,
+         U init, BinaryOperation op = {}) {
+  return parallel::reduce(std::forward<ExecutionPolicy>(policy),
+                          span<bits, const T>(range), init, op);
+}
+
+} // namespace parallel
+
+} // namespace tight_uint
@@ -0,0 +1,337 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/bulk.hpp>
+#include <tight_uint/cpu.hpp>
+#include <tight_uint/tight_uint.hpp>
+#include <vector>
+
+namespace tight_uint {
+
+namespace detail {
+
+// Widths up to this whose values never straddle a word are compared directly
+// on the packed words, many values per operation, without decoding. SIMD
+// compares of decoded values catch up sooner than scalar ones, unless pext
+// gathers the results.
+inline size_t swar_scan_bits() { return cpu().sse41 && !cpu().bmi2 ? 4 : 8; }
+
+// The top bit of every bits wide field in a word
+template <size_t bits, class T>
+constexpr T field_high_bits() {
+  T result = 0;
+  for (size_t i = bits - 1; i < word_bits<T>; i += bits)
+    result |= static_cast<T>(T(1) << i);
+  return result;
+}
+
+// value in every bits wide field of a word
+template <size_t bits, class T>
+constexpr T repeat_field(T value) {
+  T result = 0;
+  for (size_t i = 0; i < word_bits<T>; i += bits)
+    result |= static_cast<T>(value << i);
+  return result;
+}
+
+// Sets the top bit of each field of a that is less than the same field of b.
+// The low bits are compared with one subtraction that cannot borrow across
+// fields, then combined with the top bits.
+template <size_t bits, class T>
+constexpr T swar_less(T a, T b) {
+  constexpr T s_high = field_high_bits<bits, T>();
+  constexpr T s_low  = static_cast<T>(~s_high);
+  T low_ge = static_cast<T>(((a & s_low) | s_high) - (b & s_low));
+  T low_lt = static_cast<T>(~low_ge & s_high);
+  return static_cast<T>((~a & b & s_high) | (~(a ^ b) & low_lt));
+}
+
+// Moves the top bit of each field to the low word_bits / bits bits, merging
+// pairs of runs of result bits until they are contiguous
+template <size_t bits, class T>
+constexpr uint64_t compress_fields(T high) {
+  uint64_t result = uint64_t(high) >> (bits - 1);
+  if constexpr (bits > 1) {
+    constexpr auto s_masks = [] {
+      std::array<uint64_t, 6> masks{};
+      for (size_t run = 1, step = 0; run * bits < word_bits<T>;
+           run *= 2, ++step)
+        for (size_t i = 0; i < 64; ++i)
+          if (i % (2 * run * bits) < 2 * run)
+            masks[step] |= uint64_t(1) << i;
+      return masks;
+    }();
+    for (size_t run = 1, step = 0; run * bits < word_bits<T>; run *= 2, ++step)
+      result = (result | (result >> (run * bits - run))) & s_masks[step];
+  }
+  return result;
+}
+
+// Writes the low count bits of a bitmap word, keeping the rest
+inline void store_selection(uint64_t* word, uint64_t selection, size_t count) {
+  if (count == 64) {
+    *word = selection;
+  } else {
+    uint64_t mask = (uint64_t(1) << count) - 1;
+    *word         = (*word & ~mask) | selection;
+  }
+}
+
+#if defined(TIGHT_UINT_SSE41)
+
+// select_block() for 32-bit values and bounds below 2^31, which compare
+// correctly as signed lanes
+TIGHT_UINT_TARGET("sse4.1")
+inline uint64_t select_block_sse41(const uint32_t* values, uint32_t lo,
+                                   uint32_t hi) {
+  uint64_t selection = 0;
+  __m128i  vlo       = _mm_set1_epi32(static_cast<int>(lo));
+  __m128i  vhi       = _mm_set1_epi32(static_cast<int>(hi));
+  for (size_t i = 0; i < 64; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    __m128i outside =
+        _mm_or_si128(_mm_cmpgt_epi32(vlo, x), _mm_cmpgt_epi32(x, vhi));
+    uint64_t mask =
+        static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(outside)));
+    selection |= (~mask & 0xf) << i;
+  }
+  return selection;
+}
+
+#endif
+
+#if defined(TIGHT_UINT_AVX2)
+
+TIGHT_UINT_TARGET("avx2")
+inline uint64_t select_block_avx2(const uint32_t* values, uint32_t lo,
+                                  uint32_t hi) {
+  uint64_t selection = 0;
+  __m256i  vlo       = _mm256_set1_epi32(static_cast<int>(lo));
+  __m256i  vhi       = _mm256_set1_epi32(static_cast<int>(hi));
+  for (size_t i = 0; i < 64; i += 8) {
+    __m256i x =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+    __m256i outside =
+        _mm256_or_si256(_mm256_cmpgt_epi32(vlo, x), _mm256_cmpgt_epi32(x, vhi));
+    uint64_t mask = static_cast<uint64_t>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(outside)));
+    selection |= (~mask & 0xff) << i;
+  }
+  return selection;
+}
+
+#endif
+
+// Bit i is set if lo <= values[i] <= hi, for 64 decoded values
+template <class V>
+uint64_t select_block(const V* values, V lo, V hi) {
+  if constexpr (std::is_same_v<V, uint32_t>) {
+    if (hi < (V(1) << 31)) {
+#if defined(TIGHT_UINT_AVX2)
+      if (cpu().avx2)
+        return select_block_avx2(values, lo, hi);
+#endif
+#if defined(TIGHT_UINT_SSE41)
+      if (cpu().sse41)
+        return select_block_sse41(values, lo, hi);
+#endif
+    }
+  }
+  uint64_t selection = 0;
+  for (size_t i = 0; i < 64; ++i)
+    selection |= uint64_t(lo <= values[i] && values[i] <= hi) << i;
+  return selection;
+}
+
+// Scans by decoding blocks of values and comparing 64 at a time
+template <size_t bits, class T>
+size_t scan_decoded(const T* words, size_t bit_offset, size_t count, T lo,
+                    T hi, uint64_t* bitmap) {
+  size_t matches = 0;
+  for_each_block<bits>(words, bit_offset, count, [&](const auto* values,
+                                                     size_t n) {
+    using V = std::remove_const_t<std::remove_pointer_t<decltype(values)>>;
+    for (size_t i = 0; i < n; i += 64) {
+      size_t   m = std::min<size_t>(64, n - i);
+      uint64_t selection;
+      if (m == 64) {
+        selection = select_block(values + i, V(lo), V(hi));
+      } else {
+        selection = 0;
+        for (size_t j = 0; j < m; ++j)
+          selection |= uint64_t(V(lo) <= values[i + j] &&
+                                values[i + j] <= V(hi))
+                       << j;
+      }
+      store_selection(bitmap++, selection, m);
+      matches += std::popcount(selection);
+    }
+  });
+  return matches;
+}
+
+// Sets the top bit of each field of the 64 bits at words that is in
+// [lo, hi], given the bounds in every field
+template <size_t bits, class T>
+constexpr uint64_t swar_select(const T* words, uint64_t lo_words,
+                               uint64_t hi_words) {
+  uint64_t x = 0;
+  for (size_t w = 0; w < 64 / word_bits<T>; ++w)
+    x |= uint64_t(words[w]) << (w * word_bits<T>);
+  uint64_t outside =
+      swar_less<bits>(x, lo_words) | swar_less<bits>(hi_words, x);
+  return ~outside & field_high_bits<bits, uint64_t>();
+}
+
+// Scans count values starting at a word boundary. Valid when bits divides
+// the word size. Each group of words making up 64 bits is compared at once,
+// with the bits groups of one bitmap word unrolled. The last partial bitmap
+// word is decoded.
+template <size_t bits, class T>
+size_t scan_swar(const T* words, size_t count, T lo, T hi, uint64_t* bitmap) {
+  const uint64_t lo_words = repeat_field<bits>(uint64_t(lo));
+  const uint64_t hi_words = repeat_field<bits>(uint64_t(hi));
+  size_t         matches  = 0;
+  size_t         full     = count / 64;
+  for (size_t b = 0; b < full; ++b) {
+    uint64_t selection = 0;
+    for (size_t g = 0; g < bits; ++g, words += 64 / word_bits<T>)
+      selection |= compress_fields<bits, uint64_t>(
+                       swar_select<bits>(words, lo_words, hi_words))
+                   << (g * (64 / bits));
+    bitmap[b] = selection;
+    matches += std::popcount(selection);
+  }
+  return matches + scan_decoded<bits>(words, 0, count % 64, lo, hi,
+                                      bitmap + full);
+}
+
+#if defined(TIGHT_UINT_BMI2)
+
+// scan_swar() gathering the selected fields' bits with one pext
+template <size_t bits, class T>
+TIGHT_UINT_TARGET("bmi2")
+size_t scan_swar_bmi2(const T* words, size_t count, T lo, T hi,
+                      uint64_t* bitmap) {
+  constexpr uint64_t s_high   = field_high_bits<bits, uint64_t>();
+  const uint64_t     lo_words = repeat_field<bits>(uint64_t(lo));
+  const uint64_t     hi_words = repeat_field<bits>(uint64_t(hi));
+  size_t             matches  = 0;
+  size_t             full     = count / 64;
+  for (size_t b = 0; b < full; ++b) {
+    uint64_t selection = 0;
+    for (size_t g = 0; g < bits; ++g, words += 64 / word_bits<T>)
+      selection |=
+          _pext_u64(swar_select<bits>(words, lo_words, hi_words), s_high)
+          << (g * (64 / bits));
+    bitmap[b] = selection;
+    matches += std::popcount(selection);
+  }
+  return matches + scan_decoded<bits>(words, 0, count % 64, lo, hi,
+                                      bitmap + full);
+}
+
+#endif
+
+// Sets bit i of bitmap if lo <= value i <= hi, for count values, and returns
+// the number set. hi must fit in bits. Bits of the last bitmap word past
+// count are kept.
+template <size_t bits, class T>
+size_t scan_bits(const T* words, size_t bit_offset, size_t count, T lo, T hi,
+                 uint64_t* bitmap) {
+  if constexpr (bits <= 8 && word_bits<T> % bits == 0) {
+    if (bits <= swar_scan_bits() && bit_offset % word_bits<T> == 0) {
+      words += bit_offset / word_bits<T>;
+#if defined(TIGHT_UINT_BMI2)
+      // One bit fields are already contiguous
+      if (bits > 1 && cpu().bmi2)
+        return scan_swar_bmi2<bits>(words, count, lo, hi, bitmap);
+#endif
+      return scan_swar<bits>(words, count, lo, hi, bitmap);
+    }
+  }
+  return scan_decoded<bits>(words, bit_offset, count, lo, hi, bitmap);
+}
+
+// Clamps [lo, hi] to the values that fit in bits. Returns false if none do.
+template <size_t bits, class T>
+bool clamp_scan_bounds(T& lo, T& hi) {
+  hi = std::min(hi, mask_bits<bits, T>());
+  return lo <= hi;
+}
+
+} // namespace detail
+
+// Selects the values in [lo, hi]: sets bit i of bitmap if value i matches, or
+// clears it, and returns the number of matches. bitmap must hold at least
+// range.size() bits; any past that are left unchanged. Widths of at most
+// detail::swar_scan_bits() that divide the word size compare whole words of
+// packed values at once, and wider values are decoded in blocks and compared
+// with SIMD.
+template <packed_range Range>
+size_t scan_between(const Range& range, packed_value_t<Range> lo,
+                    packed_value_t<Range> hi, span<1, uint64_t> bitmap) {
+  constexpr size_t bits = Range::uint_bits::value;
+  if (bitmap.size() < range.size())
+    throw std::invalid_argument("bitmap is smaller than the range");
+  if (!detail::clamp_scan_bounds<bits>(lo, hi)) {
+    tight_uint::fill(bitmap.begin(), bitmap.begin() + range.size(),
+                     uint64_t(0));
+    return 0;
+  }
+  auto begin = range.begin();
+  return detail::scan_bits<bits>(std::to_address(begin.base()),
+                                 begin.bit_offset(), range.size(), lo, hi,
+                                 std::to_address(bitmap.begin().base()));
+}
+
+// Appends the index of each value in [lo, hi] to indices and returns the
+// number appended. Scans blocks into a small bitmap on the stack.
+template <packed_range Range>
+size_t scan_between(const Range& range, packed_value_t<Range> lo,
+                    packed_value_t<Range> hi, std::vector<size_t>& indices) {
+  constexpr size_t bits = Range::uint_bits::value;
+  if (!detail::clamp_scan_bounds<bits>(lo, hi))
+    return 0;
+  size_t                   appended = 0;
+  std::array<uint64_t, 64> bitmap;
+  auto                     begin = range.begin();
+  for (size_t first = 0; first < range.size(); first += bitmap.size() * 64) {
+    size_t n = std::min(bitmap.size() * 64, range.size() - first);
+    bitmap.fill(0);
+    appended += detail::scan_bits<bits>(
+        std::to_address(begin.base()), begin.bit_offset() + first * bits, n,
+        lo, hi, bitmap.data());
+    for (size_t w = 0; w < (n + 63) / 64; ++w)
+      for (uint64_t word = bitmap[w]; word; word &= word - 1)
+        indices.push_back(first + w * 64 + std::countr_zero(word));
+  }
+  return appended;
+}
+
+// Selects the values equal to value
+template <packed_range Range, class Output>
+size_t scan_eq(const Range& range, packed_value_t<Range> value,
+               Output&& out) {
+  return scan_between(range, value, value, std::forward<Output>(out));
+}
+
+// Selects the values less than value
+template <packed_range Range, class Output>
+size_t scan_lt(const Range& range, packed_value_t<Range> value,
+               Output&& out) {
+  if (value == 0)
+    return scan_between(range, packed_value_t<Range>(1),
+                        packed_value_t<Range>(0), std::forward<Output>(out));
+  return scan_between(range, packed_value_t<Range>(0),
+                      packed_value_t<Range>(value - 1),
+                      std::forward<Output>(out));
+}
+
+} // namespace tight_uint
@@ -0,0 +1,164 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/tight_uint.hpp>
+#include <vector>
+
+namespace tight_uint {
+
+// Search companion for a sorted packed range. Keeps every block_size-th value
+// as a plain sample, and every block_size-th sample again as a top level small
+// enough to stay in L1. A lookup binary searches the top level, then scans one
+// block of samples and one decoded block of the packed data: two cache misses
+// rather than one per step of a binary search. The default block of 64 values
+// always starts on a word boundary.
+//
+// The index refers to the range, which must outlive it. Rebuild the index
+// after modifying the values.
+template <size_t bits, class T = uint32_t, size_t block_size = 64>
+class sorted_index {
+public:
+  using value_type = std::remove_const_t<T>;
+  using size_type  = size_t;
+
+  sorted_index() = default;
+  explicit sorted_index(span<bits, const value_type> range)
+      : m_range(range),
+        m_samples((range.size() + block_size - 1) / block_size),
+        m_top((m_samples.size() + block_size - 1) / block_size) {
+    for (size_t i = 0; i < m_samples.size(); ++i)
+      m_samples[i] = m_range[i * block_size];
+    for (size_t i = 0; i < m_top.size(); ++i)
+      m_top[i] = m_samples[i * block_size];
+  }
+
+  // Index of the first value not less than key, or size() if none
+  size_type lower_bound(value_type key) const {
+    return search<false>(key);
+  }
+
+  // Index of the first value greater than key, or size() if none
+  size_type upper_bound(value_type key) const {
+    return search<true>(key);
+  }
+
+  bool contains(value_type key) const {
+    size_type i = lower_bound(key);
+    return i < m_range.size() && m_range[i] == key;
+  }
+
+  // Batched lookups. Each level is searched for all keys before the next,
+  // prefetching prefetch_distance keys ahead, so many cache misses are in
+  // flight at once. Throws std::invalid_argument if out is smaller than keys.
+  void lower_bound(std::span<const value_type> keys, std::span<size_type> out,
+                   size_t prefetch_distance = default_prefetch_distance) const {
+    search<false>(keys, out, prefetch_distance);
+  }
+  void upper_bound(std::span<const value_type> keys, std::span<size_type> out,
+                   size_t prefetch_distance = default_prefetch_distance) const {
+    search<true>(keys, out, prefetch_distance);
+  }
+
+  size_type                      size() const { return m_range.size(); }
+  const std::vector<value_type>& samples() const { return m_samples; }
+
+private:
+  // Number of values before key, or up to and including key if upper. The
+  // loop is branch free so the compiler can vectorize it.
+  template <bool upper>
+  static size_t count_before(const value_type* values, size_t count,
+                             value_type key) {
+    size_t result = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if constexpr (upper)
+        result += values[i] <= key;
+      else
+        result += values[i] < key;
+    }
+    return result;
+  }
+
+  // Number of top level samples before key. The search continues in the
+  // block of samples starting at the last of these.
+  template <bool upper>
+  size_t search_top(value_type key) const {
+    auto it = upper ? std::upper_bound(m_top.begin(), m_top.end(), key)
+                    : std::lower_bound(m_top.begin(), m_top.end(), key);
+    return it - m_top.begin();
+  }
+
+  // Number of samples before key, given the number of top level samples
+  template <bool upper>
+  size_t search_samples(size_t top, value_type key) const {
+    if (top == 0)
+      return 0;
+    size_t first = (top - 1) * block_size;
+    size_t count = std::min(block_size, m_samples.size() - first);
+    return first + count_before<upper>(m_samples.data() + first, count, key);
+  }
+
+  // Index of the result, given the number of samples before key
+  template <bool upper>
+  size_type search_block(size_t samples, value_type key) const {
+    if (samples == 0)
+      return 0;
+    size_t first = (samples - 1) * block_size;
+    size_t count = std::min(block_size, m_range.size() - first);
+    std::array<value_type, block_size> block;
+    tight_uint::unpack(m_range, first, std::span(block.data(), count));
+    return first + count_before<upper>(block.data(), count, key);
+  }
+
+  template <bool upper>
+  size_type search(value_type key) const {
+    return search_block<upper>(
+        search_samples<upper>(search_top<upper>(key), key), key);
+  }
+
+  // Prefetches the bytes [first, last) of a block, one cache line at a time
+  static void prefetch_range(const uint8_t* data, size_t first, size_t last) {
+    for (size_t line = first / 64 * 64; line < last; line += 64)
+      detail::prefetch(data + line);
+  }
+
+  template <bool upper>
+  void search(std::span<const value_type> keys, std::span<size_type> out,
+              size_t distance) const {
+    if (out.size() < keys.size())
+      throw std::invalid_argument("search output is smaller than keys");
+    // out holds each key's progress from one level to the next
+    size_t n = keys.size();
+    for (size_t i = 0; i < n; ++i)
+      out[i] = search_top<upper>(keys[i]);
+    for (size_t i = 0; i < n; ++i) {
+      if (distance && i + distance < n && out[i + distance] > 0) {
+        size_t first = (out[i + distance] - 1) * block_size;
+        prefetch_range(reinterpret_cast<const uint8_t*>(m_samples.data()),
+                       first * sizeof(value_type),
+                       std::min(first + block_size, m_samples.size()) *
+                           sizeof(value_type));
+      }
+      out[i] = search_samples<upper>(out[i], keys[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      if (distance && i + distance < n && out[i + distance] > 0) {
+        size_t first = (out[i + distance] - 1) * block_size * bits / 8;
+        prefetch_range(m_range.data(), first,
+                       std::min(first + block_size * bits / 8 + 1,
+                                m_range.size_bytes()));
+      }
+      out[i] = search_block<upper>(out[i], keys[i]);
+    }
+  }
+
+  span<bits, const value_type> m_range;
+  std::vector<value_type>      m_samples;
+  std::vector<value_type>      m_top;
+};
+
+} // namespace tight_uint
@@ -0,0 +1,163 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <span>
+#include <tight_uint/tight_uint.hpp>
+#include <utility>
+#include <vector>
+
+namespace tight_uint {
+
+namespace detail {
+
+// An LSD radix sort of bits wide keys uses radix_passes passes of
+// radix_digit_bits each. Digits of at most 11 bits keep the counters in L1.
+template <size_t bits>
+constexpr size_t radix_passes = (bits + 10) / 11;
+
+template <size_t bits>
+constexpr size_t radix_digit_bits =
+    (bits + radix_passes<bits> - 1) / radix_passes<bits>;
+
+// Below this many values the radix counters cost more than std::sort
+inline constexpr size_t radix_min_size = 1024;
+
+// Narrow values are sorted by counting each possible value, which needs no
+// copy of the data, while the counters are no bigger than the data
+template <size_t bits>
+constexpr bool use_counting_sort(size_t size) {
+  return bits <= 8 || (bits <= 16 && (size_t(1) << bits) <= size);
+}
+
+// Runs f(i) for each i in [0, n), one after another
+struct sequential_for {
+  template <class Function>
+  void operator()(size_t n, Function&& f) const {
+    for (size_t i = 0; i < n; ++i)
+      f(i);
+  }
+};
+
+// [first, last) of part i when splitting size values into n parts
+inline std::pair<size_t, size_t> part_bounds(size_t size, size_t i,
+                                             size_t n) {
+  return {size * i / n, size * (i + 1) / n};
+}
+
+// Adds the number of times each value occurs in [first, last) to counts
+template <packed_range Range>
+void count_values(const Range& range, size_t first, size_t last,
+                  size_t* counts) {
+  constexpr size_t bits  = Range::uint_bits::value;
+  auto             begin = range.begin() + first;
+  histogram_bits<bits>(std::to_address(begin.base()), begin.bit_offset(),
+                       last - first, counts);
+}
+
+// Writes the part of the sorted output in [first, last), one fill() per run
+// of equal values. starts[v] is the index of the first v and starts[values]
+// is the size.
+template <packed_range Range>
+void write_runs(Range& range, size_t first, size_t last, const size_t* starts,
+                size_t values) {
+  size_t value = std::upper_bound(starts, starts + values + 1, first) -
+                 starts - 1;
+  for (; first < last; ++value) {
+    size_t end = std::min(last, starts[value + 1]);
+    tight_uint::fill(range.begin() + first, range.begin() + end,
+                     static_cast<packed_value_t<Range>>(value));
+    first = std::max(first, end);
+  }
+}
+
+// LSD radix sort of size keys, ping-ponging with scratch. Returns whichever
+// buffer holds the result. Each pass counts digits per part, then every part
+// scatters to its own slots, so parts may run concurrently with parallel_for
+// and equal keys keep their order. Passes where all keys share a digit are
+// skipped.
+template <size_t bits, class V, class ParallelFor>
+V* radix_sort(V* keys, V* scratch, size_t size, size_t parts,
+              ParallelFor parallel_for) {
+  constexpr size_t s_digit   = radix_digit_bits<bits>;
+  constexpr size_t s_buckets = size_t(1) << s_digit;
+  std::vector<std::array<size_t, s_buckets>> counts(parts);
+  for (size_t pass = 0; pass < radix_passes<bits>; ++pass) {
+    size_t shift = pass * s_digit;
+    auto   digit = [shift](V key) { return (key >> shift) & (s_buckets - 1); };
+    parallel_for(parts, [&](size_t part) {
+      auto [first, last] = part_bounds(size, part, parts);
+      size_t* count      = counts[part].data();
+      std::fill_n(count, s_buckets, 0);
+      for (size_t i = first; i < last; ++i)
+        ++count[digit(keys[i])];
+    });
+
+    // Exclusive prefix sum over buckets, then parts within each bucket
+    size_t offset  = 0;
+    bool   trivial = false;
+    for (size_t bucket = 0; bucket < s_buckets; ++bucket) {
+      size_t bucket_start = offset;
+      for (size_t part = 0; part < parts; ++part)
+        offset += std::exchange(counts[part][bucket], offset);
+      trivial |= offset - bucket_start == size;
+    }
+    if (trivial)
+      continue;
+
+    parallel_for(parts, [&](size_t part) {
+      auto [first, last] = part_bounds(size, part, parts);
+      size_t* next       = counts[part].data();
+      for (size_t i = first; i < last; ++i)
+        scratch[next[digit(keys[i])]++] = keys[i];
+    });
+    std::swap(keys, scratch);
+  }
+  return keys;
+}
+
+} // namespace detail
+
+// Sorts in ascending order. Widths up to 16 bits count each value and
+// rewrite the range as runs with fill(), without copying the data. Wider
+// values are decoded into a scratch buffer, radix sorted in
+// radix_passes<bits> passes and packed back.
+template <packed_range Range>
+void sort(Range& range) {
+  constexpr size_t bits = Range::uint_bits::value;
+  using value_type      = packed_value_t<Range>;
+  size_t size           = range.size();
+  if (detail::use_counting_sort<bits>(size)) {
+    // Counts go one slot later so the prefix sum gives each value's start
+    std::vector<size_t> starts((size_t(1) << bits) + 1);
+    detail::count_values(range, 0, size, starts.data() + 1);
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+    detail::write_runs(range, 0, size, starts.data(), starts.size() - 1);
+    return;
+  }
+
+  std::vector<value_type> keys(size);
+  std::vector<value_type> scratch;
+  const value_type*       sorted = keys.data();
+  tight_uint::unpack(range, 0, keys);
+  if (size < detail::radix_min_size) {
+    std::sort(keys.begin(), keys.end());
+  } else {
+    scratch.resize(size);
+    sorted = detail::radix_sort<bits>(keys.data(), scratch.data(), size, 1,
+                                      detail::sequential_for{});
+  }
+  tight_uint::pack(range, 0, std::span(sorted, size));
+}
+
+// Equal values are indistinguishable, so the radix sort's stable order is
+// the same result. Provided for generic code.
+template <packed_range Range>
+void stable_sort(Range& range) {
+  tight_uint::sort(range);
+}
+
+} // namespace tight_uint
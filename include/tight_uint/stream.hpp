@@ -0,0 +1,185 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <tight_uint/bulk.hpp>
+#include <vector>
+
+namespace tight_uint {
+
+// Streams are the packed words with no header, byte for byte what a
+// vector<bits, T> of the same values holds. The value count is not stored.
+inline constexpr size_t default_stream_buffer_words = 4096;
+
+// Packs values into a fixed size word buffer and writes it out each time it
+// fills, so memory use does not grow with the stream length. The final
+// partial word is written by finish() or the destructor. write() and
+// finish() throw std::runtime_error if the stream fails. Like
+// std::basic_filebuf, the destructor swallows stream errors, so call finish()
+// to see them.
+template <size_t bits, class T = uint32_t>
+class stream_writer {
+public:
+  using value_type = T;
+  using size_type  = size_t;
+  static_assert(bits > 0 && bits < detail::word_bits<T>);
+
+  explicit stream_writer(std::ostream& out,
+                         size_t buffer_words = default_stream_buffer_words)
+      : m_out(out), m_words(std::max<size_t>(buffer_words, 1) + 1) {}
+  stream_writer(const stream_writer& other) = delete;
+  stream_writer& operator=(const stream_writer& other) = delete;
+  ~stream_writer() {
+    // Throwing here would terminate, e.g. when unwinding from a failed write()
+    try {
+      finish();
+    } catch (...) {
+    }
+  }
+
+  void push_back(value_type value) { write(std::span(&value, 1)); }
+
+  // Throws std::logic_error after finish()
+  void write(std::span<const value_type> values) {
+    if (m_finished)
+      throw std::logic_error("stream_writer write after finish");
+    const size_t capacity = buffer_bits();
+    while (!values.empty()) {
+      size_t fit   = (capacity - m_bit) / bits;
+      size_t count = std::min(fit, values.size());
+      detail::pack_bits<bits>(m_words.data(), m_bit, count, values.data());
+      m_bit += count * bits;
+      m_size += count;
+      values = values.subspan(count);
+      if (values.empty())
+        break;
+
+      // The next value straddles the end of the buffer. Pack it into the
+      // spare word, write the full buffer and move the spare word to the front.
+      detail::pack_bits<bits>(m_words.data(), m_bit, 1, values.data());
+      m_bit += bits;
+      m_size += 1;
+      values = values.subspan(1);
+      write_words(m_words.size() - 1);
+      m_words.front() = m_words.back();
+      m_bit -= capacity;
+    }
+  }
+
+  // Writes everything, zero padding the last word. Nothing more may be written
+  // afterwards.
+  void finish() {
+    if (m_finished)
+      return;
+    constexpr size_t s_bits = detail::word_bits<T>;
+    size_t           words  = (m_bit + s_bits - 1) / s_bits;
+    m_finished              = true;
+    if (m_bit % s_bits)
+      m_words[words - 1] &= static_cast<T>((T(1) << (m_bit % s_bits)) - 1);
+    write_words(words);
+    m_bit = 0;
+    m_out.flush();
+    if (!m_out)
+      throw std::runtime_error("failed to write tight_uint stream");
+  }
+
+  // Number of values written so far
+  size_type size() const { return m_size; }
+
+private:
+  size_t buffer_bits() const {
+    return (m_words.size() - 1) * detail::word_bits<T>;
+  }
+  void write_words(size_t count) {
+    m_out.write(reinterpret_cast<const char*>(m_words.data()),
+                static_cast<std::streamsize>(count * sizeof(T)));
+    if (!m_out)
+      throw std::runtime_error("failed to write tight_uint stream");
+  }
+
+  std::ostream&  m_out;
+  std::vector<T> m_words; // buffer plus one spare word for straddling values
+  size_t         m_bit      = 0;
+  size_type      m_size     = 0;
+  bool           m_finished = false;
+};
+
+// Reads size values written by stream_writer, refilling a fixed size word
+// buffer from the stream as it empties. Reads no further than the last word of
+// the packed data.
+template <size_t bits, class T = uint32_t>
+class stream_reader {
+public:
+  using value_type = T;
+  using size_type  = size_t;
+  static_assert(bits > 0 && bits < detail::word_bits<T>);
+
+  stream_reader(std::istream& in, size_type size,
+                size_t buffer_words = default_stream_buffer_words)
+      : m_in(in), m_words(std::max<size_t>(buffer_words, 2)),
+        m_remaining(size),
+        m_stream_words((size * bits + s_bits - 1) / s_bits) {}
+
+  // Reads up to out.size() values and returns the number read, which is only
+  // less at the end of the data
+  size_type read(std::span<value_type> out) {
+    size_type count = std::min(out.size(), m_remaining);
+    size_type done  = 0;
+    while (done < count) {
+      size_t available = (m_valid_words * s_bits - m_bit) / bits;
+      if (available == 0) {
+        refill();
+        continue;
+      }
+      size_t n = std::min(available, count - done);
+      detail::unpack_bits<bits>(m_words.data(), m_bit, n, out.data() + done);
+      m_bit += n * bits;
+      done += n;
+    }
+    m_remaining -= done;
+    return done;
+  }
+
+  value_type read() {
+    value_type value;
+    if (read(std::span(&value, 1)) != 1)
+      throw std::out_of_range("read past the end of the packed stream");
+    return value;
+  }
+
+  // Number of values left to read
+  size_type remaining() const { return m_remaining; }
+
+private:
+  static constexpr size_t s_bits = detail::word_bits<T>;
+
+  // Keeps the partially read word and reads as many words as fit
+  void refill() {
+    size_t first = m_bit / s_bits;
+    size_t keep  = m_valid_words - first;
+    std::memmove(m_words.data(), m_words.data() + first, keep * sizeof(T));
+    m_bit -= first * s_bits;
+    size_t count = std::min(m_words.size() - keep, m_stream_words);
+    m_in.read(reinterpret_cast<char*>(m_words.data() + keep),
+              static_cast<std::streamsize>(count * sizeof(T)));
+    if (count == 0 || static_cast<size_t>(m_in.gcount()) != count * sizeof(T))
+      throw std::runtime_error("unexpected end of packed stream");
+    m_valid_words  = keep + count;
+    m_stream_words -= count;
+  }
+
+  std::istream&  m_in;
+  std::vector<T> m_words;
+  size_t         m_bit         = 0;
+  size_t         m_valid_words = 0;
+  size_type      m_remaining;
+  size_t         m_stream_words; // words not yet read from the stream
+};
+
+} // namespace tight_uint
@@ -3,9 +3,16 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstring>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <span>
+#include <stdexcept>
+#include <tight_uint/bulk.hpp>
 #include <type_traits>
 #include <vector>
 
@@ -13,6 +20,10 @@
 #include <ranges>
 #endif
 
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
 namespace tight_uint {
 
 // clang-format off
@@ -31,17 +42,18 @@ using iterator_deref_t =
 template <class base_iterator, size_t bits>
 class uint_value {
 public:
-  using value_type                    = typename base_iterator::value_type;
+  using value_type =
+      typename std::iterator_traits<base_iterator>::value_type;
   uint_value()                        = delete;
   uint_value(const uint_value& other) = delete;
-  uint_value(const base_iterator& value, uint8_t offset)
+  constexpr uint_value(const base_iterator& value, uint8_t offset)
       : m_value(value), m_offset(offset) {
     static_assert(bits < s_type_bits);
     static_assert(std::is_unsigned_v<value_type>,
                   "signed types are not implemented");
   }
-  const uint_value& operator=(const value_type& value) const {
-    // TODO: make this atomic using std::atomic_ref
+  constexpr const uint_value& operator=(const value_type& value) const {
+    // Not atomic; see atomic_span in atomic.hpp for concurrent writes
     if constexpr (s_type_bits < 64) {
       using two_uints = typename uint_t<s_type_bits * 2>::type;
       static_assert(sizeof(two_uints) == sizeof(value_type) * 2);
@@ -73,7 +85,7 @@ public:
     }
     return *this;
   }
-  operator value_type() const {
+  constexpr operator value_type() const {
     if constexpr (s_type_bits < 64) {
       using two_uints = typename uint_t<s_type_bits * 2>::type;
       static_assert(sizeof(two_uints) == sizeof(value_type) * 2);
@@ -99,60 +111,146 @@ public:
     }
   }
 
-  uint_value& operator=(const uint_value& other) {
+  constexpr uint_value& operator=(const uint_value& other) {
     *this = static_cast<value_type>(other);
     return *this;
   }
 
 protected:
-  static constexpr value_type s_mask_bits() { return (1 << bits) - 1; };
+  static constexpr value_type s_mask_bits() {
+    return detail::mask_bits<bits, value_type>();
+  };
   static constexpr uint8_t    s_type_bits = sizeof(value_type) * 8;
   base_iterator               m_value;
   uint8_t                     m_offset;
 };
 
+// Reference wrapper for storage with at least padded_tail_bytes readable
+// bytes after the last value, e.g. padded_vector. Every access is one
+// unaligned 64-bit load, or a load and store, at the value's first byte, with
+// no branch for values that straddle two words. Any value of up to 56 bits
+// fits in the 8 bytes loaded. Little endian only, where the packed bits are
+// in increasing byte order whatever the word type.
 template <class base_iterator, size_t bits>
-class tight_iterator : base_iterator {
+class padded_uint_value {
+public:
+  using value_type =
+      typename std::iterator_traits<base_iterator>::value_type;
+  padded_uint_value()                               = delete;
+  padded_uint_value(const padded_uint_value& other) = delete;
+  constexpr padded_uint_value(const base_iterator& value, uint8_t offset)
+      : m_value(value), m_offset(offset) {
+    static_assert(bits <= 56, "padded access loads 8 bytes per value");
+    static_assert(std::endian::native == std::endian::little);
+    static_assert(std::is_unsigned_v<value_type>,
+                  "signed types are not implemented");
+  }
+  const padded_uint_value& operator=(const value_type& value) const {
+    uint64_t window = load();
+    window          = (window & ~(s_mask << shift())) |
+             ((uint64_t(value) & s_mask) << shift());
+    std::memcpy(address(), &window, sizeof(window));
+    return *this;
+  }
+  operator value_type() const {
+    return static_cast<value_type>((load() >> shift()) & s_mask);
+  }
+
+  padded_uint_value& operator=(const padded_uint_value& other) {
+    *this = static_cast<value_type>(other);
+    return *this;
+  }
+
+protected:
+  static constexpr uint64_t s_mask = (uint64_t(1) << bits) - 1;
+
+  auto* address() const {
+    using byte = std::conditional_t<
+        std::is_const_v<std::remove_reference_t<decltype(*m_value)>>,
+        const uint8_t, uint8_t>;
+    return reinterpret_cast<byte*>(std::to_address(m_value)) + m_offset / 8;
+  }
+  unsigned shift() const { return m_offset % 8; }
+  uint64_t load() const {
+    uint64_t window;
+    std::memcpy(&window, address(), sizeof(window));
+    return window;
+  }
+
+  base_iterator m_value;
+  uint8_t       m_offset;
+};
+
+// Readable bytes a reference type needs after the last value
+template <template <class, size_t> class value_reference>
+inline constexpr size_t padded_tail_bytes = 0;
+template <>
+inline constexpr size_t padded_tail_bytes<padded_uint_value> = 8;
+
+// Reference types over plain words, which the bulk kernels may read and write
+// directly. Not e.g. atomic_uint_value, which must update words atomically.
+template <template <class, size_t> class value_reference>
+inline constexpr bool is_plain_storage_v = false;
+template <>
+inline constexpr bool is_plain_storage_v<uint_value> = true;
+template <>
+inline constexpr bool is_plain_storage_v<padded_uint_value> = true;
+
+// The reference type is a template so that other write policies, e.g.
+// atomic_uint_value, can reuse the iterator
+template <class base_iterator, size_t bits,
+          template <class, size_t> class value_reference = uint_value>
+class tight_iterator {
 public:
   using iterator_category = std::random_access_iterator_tag;
   using value_type        = iterator_deref_t<base_iterator>;
-  using reference         = uint_value<base_iterator, bits>;
+  using reference         = value_reference<base_iterator, bits>;
   using const_reference   = reference; // must be the same
-  using difference_type   = typename base_iterator::difference_type;
-  using offset_type       = size_t;
+  using difference_type =
+      typename std::iterator_traits<base_iterator>::difference_type;
+  using offset_type = size_t;
 
-  tight_iterator() : m_base(), m_offsetBits(0) {}
-  tight_iterator(base_iterator iter, offset_type offsetElements)
+  constexpr tight_iterator() : m_base(), m_offsetBits(0) {}
+  constexpr tight_iterator(base_iterator iter, offset_type offsetElements)
       : m_base(iter), m_offsetBits(offsetElements * bits) {}
 
-  reference operator*() {
+  // E.g. iterator to const_iterator
+  template <class other_iterator>
+    requires std::is_convertible_v<other_iterator, base_iterator>
+  constexpr tight_iterator(
+      const tight_iterator<other_iterator, bits, value_reference>& other)
+      : m_base(other.base()), m_offsetBits(other.bit_offset()) {}
+
+  constexpr reference operator*() {
     return reference(m_base + base_element_offset(), base_element_remainder());
   }
 
-  const_reference operator*() const {
+  constexpr const_reference operator*() const {
     return const_reference(m_base + base_element_offset(),
                            base_element_remainder());
   }
 
-  reference operator[](difference_type index) { return *(*this + index); }
+  constexpr reference operator[](difference_type index) {
+    return *(*this + index);
+  }
 
-  const_reference operator[](difference_type index) const {
+  constexpr const_reference operator[](difference_type index) const {
     return *(*this + index);
   }
 
-  tight_iterator& operator++() {
+  constexpr tight_iterator& operator++() {
     m_offsetBits += bits;
     return *this;
   }
 
-  tight_iterator operator++(int) {
+  constexpr tight_iterator operator++(int) {
     tight_iterator temp = *this;
     ++(*this);
     return temp;
   }
 
-  tight_iterator& operator--() {
-    if (m_offsetBits > bits) {
+  constexpr tight_iterator& operator--() {
+    if (m_offsetBits >= bits) {
       m_offsetBits -= bits;
     } else {
       --m_base;
@@ -161,131 +259,443 @@ public:
     return *this;
   }
 
-  tight_iterator operator--(int) {
+  constexpr tight_iterator operator--(int) {
     tight_iterator temp = *this;
     --(*this);
     return temp;
   }
 
-  tight_iterator& operator+=(difference_type n) { return *this = *this + n; }
+  constexpr tight_iterator& operator+=(difference_type n) {
+    return *this = *this + n;
+  }
 
-  tight_iterator operator+(difference_type n) const {
+  constexpr tight_iterator operator+(difference_type n) const {
     tight_iterator result(*this);
+    offset_type    back_bits = static_cast<offset_type>(-n) * bits;
     if (n >= 0) {
       result.m_offsetBits += n * bits;
-    } else if (result.m_offsetBits > -n * bits) {
-      result.m_offsetBits += n * bits;
+    } else if (result.m_offsetBits >= back_bits) {
+      result.m_offsetBits -= back_bits;
     } else {
-      auto base_offset = (-n + s_baseBits - 1) / s_baseBits;
+      // Step the base back by enough whole elements
+      offset_type base_offset =
+          (back_bits - result.m_offsetBits + s_baseBits - 1) / s_baseBits;
       result.m_base -= base_offset;
-      result.m_offsetBits += base_offset + n * bits;
+      result.m_offsetBits += base_offset * s_baseBits - back_bits;
     }
     return result;
   }
 
-  friend tight_iterator operator+(difference_type n, const tight_iterator& it) {
+  friend constexpr tight_iterator operator+(difference_type       n,
+                                            const tight_iterator& it) {
     return it + n;
   }
 
-  tight_iterator& operator-=(difference_type n) { return *this += (-n); }
+  constexpr tight_iterator& operator-=(difference_type n) {
+    return *this += (-n);
+  }
 
-  tight_iterator operator-(difference_type n) const {
-    return *this = *this - n;
+  constexpr tight_iterator operator-(difference_type n) const {
+    return *this + (-n);
   }
 
-  friend tight_iterator operator-(difference_type n, const tight_iterator& it) {
+  friend constexpr tight_iterator operator-(difference_type       n,
+                                            const tight_iterator& it) {
     return it - n;
   }
 
-  difference_type operator-(const tight_iterator& other) const {
-    return (std::distance(m_base, other.m_base) * s_baseBits + m_offsetBits -
-            other.m_offsetBits) /
-           bits;
+  constexpr difference_type operator-(const tight_iterator& other) const {
+    return bit_distance(other) / static_cast<difference_type>(bits);
   }
 
-  bool operator==(const tight_iterator& other) const {
-    return (other - *this) == 0;
+  // Comparisons only need the sign of the distance in bits, not a division
+  constexpr bool operator==(const tight_iterator& other) const {
+    return bit_distance(other) == 0;
   }
 
-  bool operator!=(const tight_iterator& other) const {
+  constexpr bool operator!=(const tight_iterator& other) const {
     return !(*this == other);
   }
 
-  bool operator<(const tight_iterator& other) const {
-    return 0 < (*this - other);
+  constexpr bool operator<(const tight_iterator& other) const {
+    return bit_distance(other) < 0;
   }
 
-  bool operator<=(const tight_iterator& other) const {
-    return 0 <= (*this - other);
+  constexpr bool operator<=(const tight_iterator& other) const {
+    return bit_distance(other) <= 0;
   }
 
-  bool operator>(const tight_iterator& other) const {
-    return 0 > (*this - other);
+  constexpr bool operator>(const tight_iterator& other) const {
+    return bit_distance(other) > 0;
   }
 
-  bool operator>=(const tight_iterator& other) const {
-    return 0 >= (*this - other);
+  constexpr bool operator>=(const tight_iterator& other) const {
+    return bit_distance(other) >= 0;
   }
 
+  // Raw position for bulk kernels. Offset bits may exceed a base element.
+  constexpr const base_iterator& base() const { return m_base; }
+  constexpr offset_type          bit_offset() const { return m_offsetBits; }
+
   static constexpr offset_type s_baseBits = sizeof(value_type) * 8;
 
 private:
   base_iterator m_base;
   offset_type   m_offsetBits;
 
-  inline offset_type base_element_offset() const {
+  // Bits from other to this. The same position may have a different base and
+  // offset, e.g. after operator--.
+  constexpr difference_type bit_distance(const tight_iterator& other) const {
+    return std::distance(other.m_base, m_base) *
+               static_cast<difference_type>(s_baseBits) +
+           static_cast<difference_type>(m_offsetBits) -
+           static_cast<difference_type>(other.m_offsetBits);
+  }
+
+  constexpr offset_type base_element_offset() const {
     return m_offsetBits / s_baseBits;
   }
-  inline uint8_t base_element_remainder() const {
+  constexpr uint8_t base_element_remainder() const {
     static_assert(s_baseBits <=
                   std::numeric_limits<uint8_t>::max()); // good luck
     return m_offsetBits % s_baseBits;
   };
 };
 
-// std::vector backed array
-template <size_t bits, class T = uint32_t>
+template <class iterator>
+struct is_tight_iterator : std::false_type {};
+
+template <class base_iterator, size_t bits,
+          template <class, size_t> class value_reference>
+struct is_tight_iterator<tight_iterator<base_iterator, bits, value_reference>>
+    : std::true_type {};
+
+template <class iterator>
+constexpr bool is_tight_iterator_v = is_tight_iterator<iterator>::value;
+
+// Read-only iterator that returns values rather than a reference proxy. It
+// holds a word pointer and an index, so stepping, distances and comparisons
+// are plain integer arithmetic and simple loops over it can be vectorized.
+// Dereferencing decodes one value. Like std::vector<bool>'s iterators it
+// claims random access while returning a prvalue. Iterators are only
+// comparable when made from the same words.
+template <size_t bits, class T>
+class const_value_iterator {
+public:
+  using iterator_concept  = std::random_access_iterator_tag;
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type        = std::remove_const_t<T>;
+  using difference_type   = std::ptrdiff_t;
+  using reference         = value_type;
+  using pointer           = void;
+
+  constexpr const_value_iterator() = default;
+  constexpr const_value_iterator(const value_type* words, size_t index)
+      : m_words(words), m_index(index) {}
+
+  constexpr value_type operator*() const {
+    constexpr size_t  s_bits = detail::word_bits<value_type>;
+    constexpr auto    s_mask = detail::mask_bits<bits, value_type>();
+    size_t            bit    = m_index * bits;
+    const value_type* word   = m_words + bit / s_bits;
+    size_t            shift  = bit % s_bits;
+    if constexpr (s_bits % bits == 0) {
+      return static_cast<value_type>((word[0] >> shift) & s_mask);
+    } else if constexpr (s_bits < 64) {
+      using two_uints = typename uint_t<s_bits * 2>::type;
+      two_uints both  = word[0];
+      if (shift > s_bits - bits)
+        both |= two_uints(word[1]) << s_bits;
+      return static_cast<value_type>((both >> shift) & s_mask);
+    } else {
+      value_type result = word[0] >> shift;
+      if (shift > s_bits - bits)
+        result |= word[1] << (s_bits - shift);
+      return result & s_mask;
+    }
+  }
+  constexpr value_type operator[](difference_type n) const {
+    return *(*this + n);
+  }
+
+  constexpr const_value_iterator& operator++() {
+    ++m_index;
+    return *this;
+  }
+  constexpr const_value_iterator operator++(int) {
+    const_value_iterator result = *this;
+    ++m_index;
+    return result;
+  }
+  constexpr const_value_iterator& operator--() {
+    --m_index;
+    return *this;
+  }
+  constexpr const_value_iterator operator--(int) {
+    const_value_iterator result = *this;
+    --m_index;
+    return result;
+  }
+  constexpr const_value_iterator& operator+=(difference_type n) {
+    m_index += n;
+    return *this;
+  }
+  constexpr const_value_iterator& operator-=(difference_type n) {
+    m_index -= n;
+    return *this;
+  }
+  friend constexpr const_value_iterator operator+(const_value_iterator it,
+                                                  difference_type      n) {
+    return it += n;
+  }
+  friend constexpr const_value_iterator operator+(difference_type      n,
+                                                  const_value_iterator it) {
+    return it += n;
+  }
+  friend constexpr const_value_iterator operator-(const_value_iterator it,
+                                                  difference_type      n) {
+    return it -= n;
+  }
+  friend constexpr difference_type operator-(const const_value_iterator& lhs,
+                                             const const_value_iterator& rhs) {
+    return static_cast<difference_type>(lhs.m_index - rhs.m_index);
+  }
+
+  friend constexpr bool operator==(const const_value_iterator& lhs,
+                                   const const_value_iterator& rhs) {
+    return lhs.m_index == rhs.m_index;
+  }
+  friend constexpr auto operator<=>(const const_value_iterator& lhs,
+                                    const const_value_iterator& rhs) {
+    return lhs.m_index <=> rhs.m_index;
+  }
+
+  // Raw position for bulk kernels, like tight_iterator
+  constexpr const value_type* base() const { return m_words; }
+  constexpr size_t            bit_offset() const { return m_index * bits; }
+
+private:
+  const value_type* m_words = nullptr;
+  size_t            m_index = 0;
+};
+
+// Decodes a packed range into plain values. This uses the bulk SIMD kernels
+// when the destination is contiguous, rather than decoding one uint_value at a
+// time. Note that std::copy and std::ranges::copy cannot be customized, so
+// call this directly.
+template <class base_iterator, size_t bits,
+          template <class, size_t> class R, class OutputIt>
+  requires is_plain_storage_v<R>
+constexpr OutputIt copy(tight_iterator<base_iterator, bits, R> first,
+                        tight_iterator<base_iterator, bits, R> last,
+                        OutputIt                               d_first) {
+  if constexpr (std::contiguous_iterator<base_iterator> &&
+                std::contiguous_iterator<OutputIt>) {
+    auto count = last - first;
+    if (std::is_constant_evaluated())
+      detail::unpack_scalar<bits>(std::to_address(first.base()),
+                                  first.bit_offset(), count,
+                                  std::to_address(d_first));
+    else
+      detail::unpack_bits<bits>(std::to_address(first.base()),
+                                first.bit_offset(), count,
+                                std::to_address(d_first));
+    return d_first + count;
+  } else {
+    return std::copy(first, last, d_first);
+  }
+}
+
+// Encodes plain values into a packed range. Contiguous input is packed
+// directly. Other input is staged through a small buffer so the words are
+// still written whole rather than one uint_value at a time.
+template <class InputIt, class Sentinel, class base_iterator, size_t bits,
+          template <class, size_t> class R>
+  requires(!is_tight_iterator_v<InputIt> && is_plain_storage_v<R>)
+constexpr tight_iterator<base_iterator, bits, R>
+copy(InputIt first, Sentinel last,
+     tight_iterator<base_iterator, bits, R> d_first) {
+  using value_type =
+      typename tight_iterator<base_iterator, bits, R>::value_type;
+  if constexpr (!std::contiguous_iterator<base_iterator>) {
+    for (; first != last; ++first, ++d_first)
+      *d_first = *first;
+    return d_first;
+  } else if constexpr (std::contiguous_iterator<InputIt> &&
+                       std::sized_sentinel_for<Sentinel, InputIt>) {
+    auto count = last - first;
+    if (std::is_constant_evaluated())
+      detail::pack_scalar<bits>(std::to_address(d_first.base()),
+                                d_first.bit_offset(), count,
+                                std::to_address(first));
+    else
+      detail::pack_bits<bits>(std::to_address(d_first.base()),
+                              d_first.bit_offset(), count,
+                              std::to_address(first));
+    return d_first + count;
+  } else {
+    std::array<value_type, 256> buffer;
+    while (first != last) {
+      size_t count = 0;
+      for (; count < buffer.size() && first != last; ++count, ++first)
+        buffer[count] = static_cast<value_type>(*first);
+      detail::pack_bits<bits>(std::to_address(d_first.base()),
+                              d_first.bit_offset(), count, buffer.data());
+      d_first += count;
+    }
+    return d_first;
+  }
+}
+
+// Copies between packed ranges of the same width and word type a word at a
+// time, shifting when the two bit offsets differ, rather than decoding and
+// encoding each value
+template <class InputBase, class OutputBase, size_t bits,
+          template <class, size_t> class R1, template <class, size_t> class R2>
+  requires std::is_same_v<std::remove_const_t<iterator_deref_t<InputBase>>,
+                          iterator_deref_t<OutputBase>> &&
+           is_plain_storage_v<R1> && is_plain_storage_v<R2>
+constexpr tight_iterator<OutputBase, bits, R2>
+copy(tight_iterator<InputBase, bits, R1> first,
+     tight_iterator<InputBase, bits, R1> last,
+     tight_iterator<OutputBase, bits, R2> d_first) {
+  if constexpr (std::contiguous_iterator<InputBase> &&
+                std::contiguous_iterator<OutputBase>) {
+    auto count = last - first;
+    detail::copy_bits(std::to_address(first.base()), first.bit_offset(),
+                      std::to_address(d_first.base()), d_first.bit_offset(),
+                      count * bits);
+    return d_first + count;
+  } else {
+    return std::copy(first, last, d_first);
+  }
+}
+
+// Writes value to every element, building the repeating word pattern once and
+// copying it in blocks. Like copy(), std::fill cannot be customized, so call
+// this directly.
+template <class base_iterator, size_t bits, template <class, size_t> class R>
+  requires is_plain_storage_v<R>
+constexpr void fill(tight_iterator<base_iterator, bits, R> first,
+                    tight_iterator<base_iterator, bits, R> last,
+                    iterator_deref_t<base_iterator>        value) {
+  if constexpr (std::contiguous_iterator<base_iterator>) {
+    detail::fill_bits<bits>(std::to_address(first.base()), first.bit_offset(),
+                            last - first, value);
+  } else {
+    std::fill(first, last, value);
+  }
+}
+
+// Compares packed ranges of the same width and word type a word at a time
+template <class Base1, class Base2, size_t bits,
+          template <class, size_t> class R1, template <class, size_t> class R2>
+  requires std::is_same_v<std::remove_const_t<iterator_deref_t<Base1>>,
+                          std::remove_const_t<iterator_deref_t<Base2>>> &&
+           is_plain_storage_v<R1> && is_plain_storage_v<R2>
+constexpr bool equal(tight_iterator<Base1, bits, R1> first1,
+                     tight_iterator<Base1, bits, R1> last1,
+                     tight_iterator<Base2, bits, R2> first2) {
+  if constexpr (std::contiguous_iterator<Base1> &&
+                std::contiguous_iterator<Base2>) {
+    return detail::equal_bits(std::to_address(first1.base()),
+                              first1.bit_offset(),
+                              std::to_address(first2.base()),
+                              first2.bit_offset(), (last1 - first1) * bits);
+  } else {
+    return std::equal(first1, last1, first2);
+  }
+}
+
+// std::vector backed array. The allocator allocates whole words, e.g.
+// std::pmr::polymorphic_allocator<T> or aligned_allocator from allocator.hpp.
+// value_reference selects the element access, e.g. padded_uint_value, and the
+// storage keeps whatever zeroed tail padding it needs.
+template <size_t bits, class T = uint32_t, class Allocator = std::allocator<T>,
+          template <class, size_t> class value_reference = uint_value>
 class vector {
+  using container_type = std::vector<T, Allocator>;
+
 public:
-  using iterator = tight_iterator<typename std::vector<T>::iterator, bits>;
+  using iterator = tight_iterator<typename container_type::iterator, bits,
+                                  value_reference>;
   using const_iterator =
-      tight_iterator<typename std::add_const_t<std::vector<T>>::const_iterator,
-                     bits>;
+      tight_iterator<typename container_type::const_iterator, bits,
+                     value_reference>;
+  using allocator_type  = Allocator;
   using value_type      = typename iterator::value_type;
   using reference       = typename iterator::reference;
   using const_reference = typename const_iterator::const_reference;
   using size_type       = typename iterator::offset_type;
   using difference_type = typename iterator::difference_type;
+  using uint_bits       = std::integral_constant<size_t, bits>;
 
   vector() {}
+  explicit vector(const Allocator& alloc) : m_container(alloc) {}
   vector(const vector& other)
       : m_container(other.m_container), m_size(other.m_size) {}
+  vector(const vector& other, const Allocator& alloc)
+      : m_container(other.m_container, alloc), m_size(other.m_size) {}
   explicit vector(vector&& other)
       : m_container(std::move(other.m_container)), m_size(other.m_size) {
     other.m_size = 0;
   }
-  explicit vector(size_type size)
-      : m_container(required_base_elements(size)), m_size(size) {}
-  explicit vector(size_type size, const value_type& init)
-      : m_container(required_base_elements(size)), m_size(size) {
-    std::fill(begin(), end(), init);
+  explicit vector(size_type size, const Allocator& alloc = Allocator())
+      : m_container(required_base_elements(size), alloc), m_size(size) {}
+  explicit vector(size_type size, const value_type& init,
+                  const Allocator& alloc = Allocator())
+      : m_container(required_base_elements(size), alloc), m_size(size) {
+    tight_uint::fill(begin(), end(), init);
   }
-  vector(std::initializer_list<T> init)
-      : m_container(required_base_elements(init.size())), m_size(init.size()) {
-    std::copy(init.begin(), init.end(), begin());
+  vector(std::initializer_list<T> init, const Allocator& alloc = Allocator())
+      : m_container(required_base_elements(init.size()), alloc),
+        m_size(init.size()) {
+    tight_uint::copy(init.begin(), init.end(), begin());
   }
 
 #ifdef __cpp_lib_ranges
   friend vector& operator|(std::ranges::input_range auto&& range,
                            vector&                         container) {
-    auto initial_size = container.size();
-    container.resize(container.size() + std::ranges::distance(range));
-    std::ranges::copy(range, container.begin() + initial_size);
+    container.append(std::forward<decltype(range)>(range));
     return container;
   }
   vector(std::ranges::input_range auto&& range) { range | *this; }
+  vector(std::ranges::input_range auto&& range, const Allocator& alloc)
+      : m_container(alloc) {
+    append(std::forward<decltype(range)>(range));
+  }
+
+  // Packs the whole range onto the end in one pass. Single pass ranges of
+  // unknown size are buffered and packed a block at a time.
+  void append(std::ranges::input_range auto&& range) {
+    using range_type = decltype(range);
+    if constexpr (std::ranges::forward_range<range_type> ||
+                  std::ranges::sized_range<range_type>) {
+      auto initial_size = size();
+      resize(size() + std::ranges::distance(range));
+      tight_uint::copy(std::ranges::begin(range), std::ranges::end(range),
+                       begin() + initial_size);
+    } else {
+      append_buffered(std::ranges::begin(range), std::ranges::end(range));
+    }
+  }
 #endif
 
+  // Replaces the contents, packing whole words at a time
+  template <std::forward_iterator ForwardIt>
+  void assign(ForwardIt first, ForwardIt last) {
+    resize(std::distance(first, last));
+    tight_uint::copy(first, last, begin());
+  }
+  template <std::input_iterator InputIt>
+  void assign(InputIt first, InputIt last) {
+    resize(0);
+    append_buffered(first, last);
+  }
+  void assign(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+  }
+
   reference       operator[](size_type index) { return *(begin() + index); }
   const_reference operator[](size_type index) const {
     return *(begin() + index);
@@ -299,6 +709,8 @@ public:
   const_iterator end() const {
     return const_iterator(m_container.begin(), m_size);
   }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
 
   uint8_t* data() { return reinterpret_cast<uint8_t*>(m_container.data()); }
   const uint8_t* data() const {
@@ -308,12 +720,23 @@ public:
     return m_container.size() * sizeof(value_type);
   }
   size_type size() const { return m_size; }
+  allocator_type get_allocator() const { return m_container.get_allocator(); }
 
   size_type capacity() const {
-    return (m_container.capacity() * iterator::s_baseBits) / bits;
+    size_type words = std::max(m_container.capacity(), s_padding_words);
+    return ((words - s_padding_words) * iterator::s_baseBits) / bits;
   }
   void resize(size_type size) {
-    m_container.resize(required_base_elements(size));
+    size_type words = required_base_elements(size);
+    // Clear bits past the end so growing again reads zeros
+    if (size < m_size) {
+      std::fill_n(m_container.begin() + (words - s_padding_words),
+                  s_padding_words, T(0));
+      if ((size * bits) % iterator::s_baseBits)
+        m_container[words - s_padding_words - 1] &= static_cast<T>(
+            (T(1) << (size * bits) % iterator::s_baseBits) - 1);
+    }
+    m_container.resize(words);
     m_size = size;
   }
   void reserve(size_type capacity) {
@@ -328,23 +751,159 @@ public:
     resize(m_size + 1);
     back() = value;
   }
+  void pop_back() { resize(m_size - 1); }
+
+  // Inserts shift the tail with a word level bit memmove and then pack the
+  // new values, rather than moving one value at a time
+  iterator insert(const_iterator pos, const value_type& value) {
+    return insert(pos, size_type(1), value);
+  }
+  iterator insert(const_iterator pos, size_type count,
+                  const value_type& value) {
+    iterator result = make_gap(pos, count);
+    tight_uint::fill(result, result + count, value);
+    return result;
+  }
+  template <std::forward_iterator InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    iterator result = make_gap(pos, std::distance(first, last));
+    tight_uint::copy(first, last, result);
+    return result;
+  }
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+  iterator erase(const_iterator first, const_iterator last) {
+    size_type index = first - cbegin();
+    size_type count = last - first;
+    detail::move_bits(m_container.data(), index * bits,
+                      (index + count) * bits, (m_size - index - count) * bits);
+    resize(m_size - count);
+    return begin() + index;
+  }
+
+  void shrink_to_fit() { m_container.shrink_to_fit(); }
+
+  friend bool operator==(const vector& lhs, const vector& rhs) {
+    return lhs.size() == rhs.size() &&
+           tight_uint::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
 
 private:
-  std::vector<T>          m_container;
+  // Packs single pass input onto the end, which cannot be measured up front
+  template <class InputIt, class Sentinel>
+  void append_buffered(InputIt first, Sentinel last) {
+    std::array<value_type, 256> block;
+    while (first != last) {
+      size_type count = 0;
+      for (; count < block.size() && first != last; ++first)
+        block[count++] = static_cast<value_type>(*first);
+      size_type initial_size = size();
+      resize(initial_size + count);
+      tight_uint::copy(block.begin(), block.begin() + count,
+                       begin() + initial_size);
+    }
+  }
+
+  // Resizes and moves [pos, end()) count values later
+  iterator make_gap(const_iterator pos, size_type count) {
+    size_type index = pos - cbegin();
+    size_type tail  = m_size - index;
+    resize(m_size + count);
+    detail::move_bits(m_container.data(), (index + count) * bits,
+                      index * bits, tail * bits);
+    return begin() + index;
+  }
+
+  static constexpr size_type s_padding_words =
+      (padded_tail_bytes<value_reference> + sizeof(T) - 1) / sizeof(T);
+
+  container_type          m_container;
   size_type               m_size = 0;
   static inline size_type required_base_elements(size_type size) {
-    // Round up
-    return (size * bits + iterator::s_baseBits - 1) / iterator::s_baseBits;
+    // Round up, plus any padding
+    return (size * bits + iterator::s_baseBits - 1) / iterator::s_baseBits +
+           s_padding_words;
+  }
+};
+
+// Fixed size array with inline std::array storage. It is trivially copyable
+// and usable in constant expressions, e.g. to build a lookup table at compile
+// time, and can be embedded by value in other structs.
+template <size_t bits, size_t N, class T = uint32_t>
+class array {
+public:
+  using iterator        = tight_iterator<T*, bits>;
+  using const_iterator  = tight_iterator<const T*, bits>;
+  using value_type      = typename iterator::value_type;
+  using reference       = typename iterator::reference;
+  using const_reference = typename const_iterator::const_reference;
+  using size_type       = typename iterator::offset_type;
+  using difference_type = typename iterator::difference_type;
+  using uint_bits       = std::integral_constant<size_t, bits>;
+
+  constexpr array() = default;
+  constexpr array(std::initializer_list<T> init) {
+    if (init.size() > N)
+      throw std::out_of_range("too many initializers for tight_uint::array");
+    tight_uint::copy(init.begin(), init.end(), begin());
+  }
+
+  constexpr reference operator[](size_type index) {
+    return *(begin() + index);
+  }
+  constexpr const_reference operator[](size_type index) const {
+    return *(begin() + index);
   }
+
+  constexpr iterator       begin() { return iterator(m_words.data(), 0); }
+  constexpr const_iterator begin() const {
+    return const_iterator(m_words.data(), 0);
+  }
+  constexpr iterator       end() { return iterator(m_words.data(), N); }
+  constexpr const_iterator end() const {
+    return const_iterator(m_words.data(), N);
+  }
+  constexpr const_iterator cbegin() const { return begin(); }
+  constexpr const_iterator cend() const { return end(); }
+
+  constexpr reference       front() { return *begin(); }
+  constexpr const_reference front() const { return *begin(); }
+  constexpr reference       back() { return *(end() - 1); }
+  constexpr const_reference back() const { return *(end() - 1); }
+
+  constexpr void fill(const value_type& value) {
+    tight_uint::fill(begin(), end(), value);
+  }
+
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(m_words.data()); }
+  const uint8_t* data() const {
+    return reinterpret_cast<const uint8_t*>(m_words.data());
+  }
+  static constexpr size_type size_bytes() { return sizeof(m_words); }
+  static constexpr size_type size() { return N; }
+  static constexpr bool      empty() { return N == 0; }
+
+  // Unused bits are always zero, so comparing words compares values
+  constexpr bool operator==(const array& other) const = default;
+
+private:
+  static constexpr size_type s_words =
+      (N * bits + iterator::s_baseBits - 1) / iterator::s_baseBits;
+  std::array<T, s_words> m_words{};
 };
 
 // view of existing data
-template <size_t bits, class T>
+template <size_t bits, class T,
+          template <class, size_t> class value_reference = uint_value>
 class span {
-  friend class span<bits, const T>;
+  friend class span<bits, const T, value_reference>;
 
 public:
-  using iterator        = tight_iterator<typename std::span<T>::iterator, bits>;
+  using iterator =
+      tight_iterator<typename std::span<T>::iterator, bits, value_reference>;
   using const_iterator  = iterator;
   using value_type      = typename iterator::value_type;
   using reference       = typename iterator::reference;
@@ -363,14 +922,48 @@ public:
                           std::is_convertible_v<typename U::value_type*, T*>)>>
   span(U& other) : m_span(other.m_span), m_size(other.m_size) {}
 
-  // Span from range construction
+  // Span from range construction. Not for padded access, where the size
+  // cannot be taken from the words as some of them are padding.
 #ifdef __cpp_lib_ranges
   template <std::ranges::contiguous_range Range>
+    requires(padded_tail_bytes<value_reference> == 0)
   span(Range&& range)
       : m_span(std::forward<Range>(range)),
         m_size(size_from_base_elements(m_span.size())) {}
 #endif
 
+  // View of the first size values, e.g. when the words are not full
+  span(std::span<T> words, size_type size) : m_span(words), m_size(size) {}
+
+  // View of a vector's values. The vector must have at least the tail
+  // padding this span's access needs.
+  template <class Allocator, template <class, size_t> class R>
+    requires(padded_tail_bytes<value_reference> <= padded_tail_bytes<R>)
+  span(vector<bits, std::remove_const_t<T>, Allocator, R>& other)
+      : span(std::span<T>(reinterpret_cast<T*>(other.data()),
+                          other.size_bytes() / sizeof(T)),
+             other.size()) {}
+  template <class Allocator, template <class, size_t> class R>
+    requires(std::is_const_v<T> &&
+             padded_tail_bytes<value_reference> <= padded_tail_bytes<R>)
+  span(const vector<bits, std::remove_const_t<T>, Allocator, R>& other)
+      : span(std::span<T>(reinterpret_cast<T*>(other.data()),
+                          other.size_bytes() / sizeof(T)),
+             other.size()) {}
+
+  // View of an array's values
+  template <size_t N>
+  span(array<bits, N, std::remove_const_t<T>>& other)
+      : span(std::span<T>(reinterpret_cast<T*>(other.data()),
+                          other.size_bytes() / sizeof(T)),
+             N) {}
+  template <size_t N>
+  span(const array<bits, N, std::remove_const_t<T>>& other)
+    requires std::is_const_v<T>
+      : span(std::span<T>(reinterpret_cast<T*>(other.data()),
+                          other.size_bytes() / sizeof(T)),
+             N) {}
+
   // Pass-through span constructor
   // a common error here is copy constructing non-const from const
   template <class... Args,
@@ -378,6 +971,7 @@ public:
                 std::is_same<std::decay_t<Args>, std::decay_t<Args>>...>>
 
             >
+    requires(padded_tail_bytes<value_reference> == 0)
   span(Args&&... args)
       : m_span(std::forward<Args>(args)...),
         m_size(size_from_base_elements(m_span.size())) {}
@@ -394,7 +988,11 @@ public:
   iterator       end() { return iterator(m_span.begin(), m_size); }
   const_iterator end() const { return const_iterator(m_span.begin(), m_size); }
 
-  uint8_t*       data() { return reinterpret_cast<uint8_t*>(m_span.data()); }
+  // Only const when T is const. Mirrors std::span.
+  auto* data() {
+    using byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+    return reinterpret_cast<byte*>(m_span.data());
+  }
   const uint8_t* data() const {
     return reinterpret_cast<const uint8_t*>(m_span.data());
   }
@@ -410,6 +1008,193 @@ private:
   }
 };
 
+// Ranges of compile time width values, i.e. vector and span
+template <class Range>
+concept packed_range = requires { Range::uint_bits::value; };
+
+// Unpacked value type of a packed_range
+template <class Range>
+using packed_value_t = std::remove_const_t<typename Range::value_type>;
+
+// The values of a vector, span or array as a range of const_value_iterator,
+// for read-only loops and std::ranges algorithms
+template <packed_range Range>
+constexpr auto values(const Range& range) {
+  using iterator =
+      const_value_iterator<Range::uint_bits::value, packed_value_t<Range>>;
+  const auto* words = std::to_address(range.begin().base());
+  return std::ranges::subrange(iterator(words, 0),
+                               iterator(words, range.size()));
+}
+
+// Decodes out.size() values starting at index first
+template <packed_range Range>
+void unpack(const Range& range, size_t first,
+            std::span<std::remove_const_t<typename Range::value_type>> out) {
+  auto begin = range.begin() + first;
+  tight_uint::copy(begin, begin + out.size(), out.begin());
+}
+
+// Encodes in.size() values starting at index first
+template <packed_range Range>
+void pack(Range& range, size_t first,
+          std::span<const typename Range::value_type> in) {
+  tight_uint::copy(in.begin(), in.end(), range.begin() + first);
+}
+
+// How many indices ahead gather() prefetches. Large enough to keep many
+// cache misses in flight for tables bigger than the cache.
+inline constexpr size_t default_prefetch_distance = 16;
+
+// Reads the values at each of indices into out. Word addresses are computed
+// directly from each index, prefetching prefetch_distance indices ahead (zero
+// disables it), and with AVX2 four values are fetched per gather instruction.
+// Throws std::invalid_argument if out is smaller than indices.
+template <packed_range Range>
+void gather(const Range& range, std::span<const size_t> indices,
+            std::span<std::remove_const_t<typename Range::value_type>> out,
+            size_t prefetch_distance = default_prefetch_distance) {
+  constexpr size_t bits = Range::uint_bits::value;
+  if (out.size() < indices.size())
+    throw std::invalid_argument("gather output is smaller than indices");
+  detail::gather_bits<bits>(std::to_address(range.begin().base()),
+                            range.size_bytes(), indices.data(),
+                            indices.size(), out.data(), prefetch_distance);
+}
+
+// How scatter() orders updates. as_given applies them in order with one
+// read-modify-write each. by_word sorts them by index first, so updates to the
+// same word merge into one read-modify-write and memory is walked in order,
+// at the cost of sorting and a temporary array.
+enum class scatter_order { as_given, by_word };
+
+namespace detail {
+
+template <packed_range Range, class Function>
+void scatter(Range& range, std::span<const size_t> indices,
+             std::span<const packed_value_t<Range>> values, Function& f,
+             scatter_order order, size_t prefetch_distance) {
+  constexpr size_t bits  = Range::uint_bits::value;
+  auto             words = std::to_address(range.begin().base());
+  if (values.size() < indices.size())
+    throw std::invalid_argument("scatter values are fewer than indices");
+  if (order == scatter_order::as_given) {
+    scatter_bits<bits>(words, indices.data(), values.data(), indices.size(),
+                       f, prefetch_distance);
+    return;
+  }
+  // Ties keep their original order, so later updates still apply last
+  std::vector<std::pair<size_t, size_t>> updates(indices.size());
+  for (size_t i = 0; i < indices.size(); ++i)
+    updates[i] = {indices[i], i};
+  std::sort(updates.begin(), updates.end());
+  scatter_sorted_bits<bits>(words, updates.data(), updates.size(),
+                            values.data(), f, prefetch_distance);
+}
+
+} // namespace detail
+
+// Writes values[i] to index indices[i]. With duplicate indices the last
+// update wins. Throws std::invalid_argument if values is smaller than indices.
+template <packed_range Range>
+void scatter(Range& range, std::span<const size_t> indices,
+             std::span<const packed_value_t<Range>> values,
+             scatter_order order             = scatter_order::as_given,
+             size_t        prefetch_distance = default_prefetch_distance) {
+  auto last = [](auto, auto value) { return value; };
+  detail::scatter(range, indices, values, last, order, prefetch_distance);
+}
+
+// Writes reduce(old, values[i]) to index indices[i], e.g. std::plus<>() to
+// add to counters. Duplicate indices are reduced in order. Results are
+// truncated to bits. Throws like scatter() above.
+template <packed_range Range, class Reducer>
+  requires std::invocable<Reducer&, packed_value_t<Range>,
+                          packed_value_t<Range>>
+void scatter(Range& range, std::span<const size_t> indices,
+             std::span<const packed_value_t<Range>> values, Reducer reduce,
+             scatter_order order             = scatter_order::as_given,
+             size_t        prefetch_distance = default_prefetch_distance) {
+  detail::scatter(range, indices, values, reduce, order, prefetch_distance);
+}
+
+// How transcode() handles a value too wide for a narrower destination
+enum class narrowing {
+  checked,   // throw std::out_of_range
+  unchecked, // keep the low bits
+};
+
+// Converts in.size() values to the bit width and word type of out, writing
+// from the start of out. Throws std::invalid_argument if out is smaller. A
+// checked narrowing throws std::out_of_range on a value that does not fit;
+// values before it may already have been written.
+template <packed_range In, packed_range Out>
+void transcode(const In& in, Out& out, narrowing mode = narrowing::checked) {
+  constexpr size_t a = In::uint_bits::value;
+  constexpr size_t b = Out::uint_bits::value;
+  if (out.size() < in.size())
+    throw std::invalid_argument("transcode destination is too small");
+  size_t done =
+      detail::transcode_bits<a, b>(std::to_address(in.begin().base()),
+                                   in.begin().bit_offset(),
+                                   std::to_address(out.begin().base()),
+                                   out.begin().bit_offset(), in.size(),
+                                   mode == narrowing::checked);
+  if (done != in.size())
+    throw std::out_of_range("value does not fit in the destination width");
+}
+
+// Returns a copy of in with a different bit width and word type
+template <size_t bits, class T = uint32_t, packed_range In>
+vector<bits, T> transcode(const In& in, narrowing mode = narrowing::checked) {
+  vector<bits, T> result(in.size());
+  transcode(in, result, mode);
+  return result;
+}
+
+// Reductions run on the packed words, decoding L1 sized blocks with the SIMD
+// unpack kernels rather than dereferencing each value
+
+// Sum of all values in a 64 bit accumulator
+template <packed_range Range>
+uint64_t sum(const Range& range) {
+  return detail::sum_bits<Range::uint_bits::value>(
+      std::to_address(range.begin().base()), range.begin().bit_offset(),
+      range.size());
+}
+
+// Smallest and largest value. Throws std::invalid_argument if empty.
+template <packed_range Range>
+std::ranges::min_max_result<packed_value_t<Range>>
+min_max(const Range& range) {
+  if (range.size() == 0)
+    throw std::invalid_argument("min_max of an empty range");
+  auto [min, max] = detail::min_max_bits<Range::uint_bits::value>(
+      std::to_address(range.begin().base()), range.begin().bit_offset(),
+      range.size());
+  return {min, max};
+}
+
+// Number of values equal to value
+template <packed_range Range>
+size_t count(const Range& range, packed_value_t<Range> value) {
+  return detail::count_bits<Range::uint_bits::value>(
+      std::to_address(range.begin().base()), range.begin().bit_offset(),
+      range.size(), value);
+}
+
+// Adds the number of times each value occurs to counts[value]. counts needs
+// an entry for every possible value, 2^bits.
+template <packed_range Range>
+void histogram(const Range& range, std::span<size_t> counts) {
+  constexpr size_t bits = Range::uint_bits::value;
+  if (counts.size() < (size_t(1) << bits))
+    throw std::invalid_argument("histogram needs 2^bits counts");
+  detail::histogram_bits<bits>(std::to_address(range.begin().base()),
+                               range.begin().bit_offset(), range.size(),
+                               counts.data());
+}
+
 #ifdef __cpp_lib_ranges
 template <size_t bits>
 auto make_tight_span(auto&& range) {
@@ -419,4 +1204,24 @@ auto make_tight_span(auto&& range) {
 }
 #endif
 
+// Vector and span with branch-free element access through padded_uint_value.
+// The vector keeps 8 bytes of zeroed padding after the last word. A
+// padded_span over other memory requires the same, and is constructed from
+// the words and a value count so the padding is not read as values.
+template <size_t bits, class T = uint32_t, class Allocator = std::allocator<T>>
+using padded_vector = vector<bits, T, Allocator, padded_uint_value>;
+
+template <size_t bits, class T>
+using padded_span = span<bits, T, padded_uint_value>;
+
+#ifdef __cpp_lib_memory_resource
+namespace pmr {
+
+// Packed vector with a std::pmr::memory_resource, e.g. an arena or pool
+template <size_t bits, class T = uint32_t>
+using vector = tight_uint::vector<bits, T, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+#endif
+
 } // namespace tight_uint
@@ -0,0 +1,431 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+// Benchmarks every bit width and word type against a plain
+// std::vector<uint32_t>, the micromesh helpers and a naive shift and mask
+// loop. Results are printed as a table and optionally saved as nanobench CSV
+// or JSON for tracking regressions. --cpu limits the kernels to a comma
+// separated list of sse4.1, avx2, avx512bw, bmi2 and popcnt, or none, to
+// compare them.
+//
+// Usage: tight_uint_benchmarks [--csv file] [--json file] [--size n]
+//                              [--min-bits n] [--max-bits n] [--quick]
+//                              [--cpu list]
+
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include <algorithm>
+#include <compare_nvidia_micromesh.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <nanobench.h>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tight_uint/cpu.hpp>
+#include <tight_uint/scan.hpp>
+#include <tight_uint/sort.hpp>
+#include <tight_uint/tight_uint.hpp>
+#include <utility>
+#include <vector>
+
+using namespace ankerl;
+
+namespace {
+
+struct options {
+  size_t                   size     = 1 << 16;
+  size_t                   min_bits = 1;
+  size_t                   max_bits = 63;
+  bool                     quick    = false;
+  tight_uint::cpu_features cpu      = tight_uint::detect_cpu_features();
+  std::string              csv_path;
+  std::string              json_path;
+};
+
+template <class T>
+const char* word_name() {
+  if constexpr (std::is_same_v<T, uint8_t>)
+    return "uint8_t";
+  else if constexpr (std::is_same_v<T, uint16_t>)
+    return "uint16_t";
+  else if constexpr (std::is_same_v<T, uint32_t>)
+    return "uint32_t";
+  else
+    return "uint64_t";
+}
+
+// Shared inputs for one bit width
+struct inputs {
+  std::vector<uint64_t> values;  // already masked to the bit width
+  std::vector<uint32_t> indices; // random permutation for random access
+};
+
+inputs make_inputs(size_t size, size_t bits) {
+  std::mt19937_64 rng(bits);
+  uint64_t        mask = (uint64_t(1) << bits) - 1;
+  inputs          result;
+  result.values.resize(size);
+  result.indices.resize(size);
+  for (auto& value : result.values)
+    value = rng() & mask;
+  std::iota(result.indices.begin(), result.indices.end(), 0u);
+  std::shuffle(result.indices.begin(), result.indices.end(), rng);
+  return result;
+}
+
+void run(nanobench::Bench& bench, const std::string& op,
+         const std::string& impl, const std::string& word, size_t bits,
+         auto&& f) {
+  bench.context("op", op)
+      .context("impl", impl)
+      .context("word", word)
+      .context("bits", std::to_string(bits))
+      .run(op + " " + impl + "<" + std::to_string(bits) + ", " + word + ">",
+           f);
+}
+
+// The library at compile time width bits with T words
+template <size_t bits, class T>
+void bench_tight(nanobench::Bench& bench, const options& opt) {
+  if (bits < opt.min_bits || bits > opt.max_bits)
+    return;
+  inputs                      in = make_inputs(opt.size, bits);
+  std::vector<T>              values(in.values.begin(), in.values.end());
+  tight_uint::vector<bits, T> array(values);
+  std::vector<T>              out(opt.size);
+  const char*                 impl = "tight_uint";
+  const char*                 word = word_name<T>();
+
+  run(bench, "seq_read", impl, word, bits, [&] {
+    uint64_t sum = 0;
+    for (T value : array)
+      sum += value;
+    nanobench::doNotOptimizeAway(sum);
+  });
+  run(bench, "random_read", impl, word, bits, [&] {
+    uint64_t sum = 0;
+    for (uint32_t i : in.indices)
+      sum += array[i];
+    nanobench::doNotOptimizeAway(sum);
+  });
+  std::vector<size_t> indices(in.indices.begin(), in.indices.end());
+  run(bench, "gather", impl, word, bits, [&] {
+    tight_uint::gather(array, indices, out);
+    nanobench::doNotOptimizeAway(out.data());
+  });
+  run(bench, "seq_write", impl, word, bits, [&] {
+    for (size_t i = 0; i < values.size(); ++i)
+      array[i] = values[i];
+    nanobench::doNotOptimizeAway(array.data());
+  });
+  run(bench, "random_write", impl, word, bits, [&] {
+    for (uint32_t i : in.indices)
+      array[i] = values[i];
+    nanobench::doNotOptimizeAway(array.data());
+  });
+  run(bench, "scatter", impl, word, bits, [&] {
+    tight_uint::scatter(array, indices, std::span<const T>(values),
+                        tight_uint::scatter_order::by_word);
+    nanobench::doNotOptimizeAway(array.data());
+  });
+  run(bench, "fill", impl, word, bits, [&] {
+    tight_uint::fill(array.begin(), array.end(), values[0]);
+    nanobench::doNotOptimizeAway(array.data());
+  });
+  run(bench, "unpack", impl, word, bits, [&] {
+    tight_uint::copy(array.begin(), array.end(), out.begin());
+    nanobench::doNotOptimizeAway(out.data());
+  });
+  run(bench, "pack", impl, word, bits, [&] {
+    array.assign(values.begin(), values.end());
+    nanobench::doNotOptimizeAway(array.data());
+  });
+  // Packed to packed, shifted by one value so the bit offsets differ and
+  // every destination word is a funnel shift of two source words
+  tight_uint::vector<bits, T> shifted(opt.size + 1);
+  run(bench, "copy", impl, word, bits, [&] {
+    tight_uint::copy(array.begin(), array.end(), shifted.begin() + 1);
+    nanobench::doNotOptimizeAway(shifted.data());
+  });
+  run(bench, "accumulate", impl, word, bits, [&] {
+    uint64_t sum = std::accumulate(array.begin(), array.end(), uint64_t(0));
+    nanobench::doNotOptimizeAway(sum);
+  });
+  run(bench, "sum", impl, word, bits, [&] {
+    nanobench::doNotOptimizeAway(tight_uint::sum(array));
+  });
+  tight_uint::vector<1, uint64_t> selection(opt.size);
+  run(bench, "scan", impl, word, bits, [&] {
+    nanobench::doNotOptimizeAway(
+        tight_uint::scan_lt(array, values[0], selection));
+  });
+  run(bench, "sort", impl, word, bits, [&] {
+    array.assign(values.begin(), values.end());
+    tight_uint::sort(array);
+    nanobench::doNotOptimizeAway(array.data());
+  });
+  run(bench, "iterator_arithmetic", impl, word, bits, [&] {
+    // Random jumps, distances and dereferences without a linear walk
+    uint64_t sum   = 0;
+    auto     first = array.begin();
+    for (uint32_t i : in.indices) {
+      auto it = first + i;
+      sum += *it + static_cast<uint64_t>(array.end() - it);
+    }
+    nanobench::doNotOptimizeAway(sum);
+  });
+
+  // Element access without the straddle branch
+  if constexpr (bits <= 56) {
+    tight_uint::padded_vector<bits, T> padded(values);
+    const char*                        padded_impl = "tight_uint_padded";
+    run(bench, "seq_read", padded_impl, word, bits, [&] {
+      uint64_t sum = 0;
+      for (T value : padded)
+        sum += value;
+      nanobench::doNotOptimizeAway(sum);
+    });
+    run(bench, "random_read", padded_impl, word, bits, [&] {
+      uint64_t sum = 0;
+      for (uint32_t i : in.indices)
+        sum += padded[i];
+      nanobench::doNotOptimizeAway(sum);
+    });
+    run(bench, "seq_write", padded_impl, word, bits, [&] {
+      for (size_t i = 0; i < values.size(); ++i)
+        padded[i] = values[i];
+      nanobench::doNotOptimizeAway(padded.data());
+    });
+    run(bench, "random_write", padded_impl, word, bits, [&] {
+      for (uint32_t i : in.indices)
+        padded[i] = values[i];
+      nanobench::doNotOptimizeAway(padded.data());
+    });
+  }
+}
+
+template <class T, size_t... i>
+void bench_widths(nanobench::Bench& bench, const options& opt,
+                  std::index_sequence<i...>) {
+  (bench_tight<i + 1, T>(bench, opt), ...);
+}
+
+uint64_t naive_read(const uint64_t* words, size_t index, size_t bits) {
+  size_t   bit   = index * bits;
+  size_t   shift = bit % 64;
+  uint64_t value = words[bit / 64] >> shift;
+  if (shift + bits > 64)
+    value |= words[bit / 64 + 1] << (64 - shift);
+  return value & ((uint64_t(1) << bits) - 1);
+}
+
+void naive_write(uint64_t* words, size_t index, size_t bits, uint64_t value) {
+  size_t   bit   = index * bits;
+  size_t   shift = bit % 64;
+  uint64_t mask  = (uint64_t(1) << bits) - 1;
+  words[bit / 64] = (words[bit / 64] & ~(mask << shift)) | (value << shift);
+  if (shift + bits > 64)
+    words[bit / 64 + 1] = (words[bit / 64 + 1] & ~(mask >> (64 - shift))) |
+                          (value >> (64 - shift));
+}
+
+// Runtime width baselines. Reader and writer take (index, value) so the same
+// loops serve the naive and micromesh implementations.
+void bench_baseline(nanobench::Bench& bench, const options& opt,
+                    const inputs& in, const std::string& impl,
+                    const std::string& word, size_t bits, auto read,
+                    auto write) {
+  std::vector<uint64_t> out(opt.size);
+  for (size_t i = 0; i < in.values.size(); ++i)
+    write(i, in.values[i]);
+
+  run(bench, "seq_read", impl, word, bits, [&] {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < opt.size; ++i)
+      sum += read(i);
+    nanobench::doNotOptimizeAway(sum);
+  });
+  run(bench, "random_read", impl, word, bits, [&] {
+    uint64_t sum = 0;
+    for (uint32_t i : in.indices)
+      sum += read(i);
+    nanobench::doNotOptimizeAway(sum);
+  });
+  run(bench, "seq_write", impl, word, bits, [&] {
+    for (size_t i = 0; i < opt.size; ++i)
+      write(i, in.values[i]);
+  });
+  run(bench, "random_write", impl, word, bits, [&] {
+    for (uint32_t i : in.indices)
+      write(i, in.values[i]);
+  });
+  run(bench, "fill", impl, word, bits, [&] {
+    for (size_t i = 0; i < opt.size; ++i)
+      write(i, in.values[0]);
+  });
+  run(bench, "unpack", impl, word, bits, [&] {
+    for (size_t i = 0; i < opt.size; ++i)
+      out[i] = read(i);
+    nanobench::doNotOptimizeAway(out.data());
+  });
+  run(bench, "pack", impl, word, bits, [&] {
+    for (size_t i = 0; i < opt.size; ++i)
+      write(i, in.values[i]);
+  });
+  run(bench, "sort", impl, word, bits, [&] {
+    for (size_t i = 0; i < opt.size; ++i)
+      write(i, in.values[i]);
+    for (size_t i = 0; i < opt.size; ++i)
+      out[i] = read(i);
+    std::sort(out.begin(), out.end());
+    for (size_t i = 0; i < opt.size; ++i)
+      write(i, out[i]);
+  });
+}
+
+void bench_baselines(nanobench::Bench& bench, const options& opt,
+                     size_t bits) {
+  inputs in = make_inputs(opt.size, bits);
+
+  std::vector<uint64_t> naive((opt.size * bits + 63) / 64 + 1);
+  bench_baseline(
+      bench, opt, in, "naive", "uint64_t", bits,
+      [&](size_t i) { return naive_read(naive.data(), i, bits); },
+      [&](size_t i, uint64_t v) { naive_write(naive.data(), i, bits, v); });
+
+  if (bits <= 32) {
+    std::vector<uint32_t> micromesh((opt.size * bits + 31) / 32 + 1);
+    uint32_t              width = static_cast<uint32_t>(bits);
+    bench_baseline(
+        bench, opt, in, "micromesh", "uint32_t", bits,
+        [&](size_t i) {
+          return packedBitRead(micromesh.data(),
+                               static_cast<uint32_t>(i) * width, width);
+        },
+        [&](size_t i, uint64_t v) {
+          packedBitWrite(micromesh.data(), static_cast<uint32_t>(i) * width,
+                         width, static_cast<uint32_t>(v));
+        });
+  }
+}
+
+// Unpacked reference, independent of the bit width
+void bench_std_vector(nanobench::Bench& bench, const options& opt) {
+  inputs                in = make_inputs(opt.size, 32);
+  std::vector<uint32_t> values(in.values.begin(), in.values.end());
+  std::vector<uint32_t> array(values);
+  std::vector<uint32_t> out(opt.size);
+  const char*           impl = "std::vector";
+  const char*           word = "uint32_t";
+  bench_baseline(
+      bench, opt, in, impl, word, 32, [&](size_t i) { return array[i]; },
+      [&](size_t i, uint64_t v) { array[i] = static_cast<uint32_t>(v); });
+  std::vector<uint32_t> shifted(opt.size + 1);
+  run(bench, "copy", impl, word, 32, [&] {
+    std::copy(array.begin(), array.end(), shifted.begin() + 1);
+    nanobench::doNotOptimizeAway(shifted.data());
+  });
+  run(bench, "accumulate", impl, word, 32, [&] {
+    uint64_t sum = std::accumulate(array.begin(), array.end(), uint64_t(0));
+    nanobench::doNotOptimizeAway(sum);
+  });
+  run(bench, "iterator_arithmetic", impl, word, 32, [&] {
+    uint64_t sum   = 0;
+    auto     first = array.begin();
+    for (uint32_t i : in.indices) {
+      auto it = first + i;
+      sum += *it + static_cast<uint64_t>(array.end() - it);
+    }
+    nanobench::doNotOptimizeAway(sum);
+  });
+}
+
+// Features from a comma separated list, or false for an unknown name
+bool parse_cpu(const std::string& list, tight_uint::cpu_features& cpu) {
+  cpu = {};
+  std::istringstream names(list);
+  for (std::string name; std::getline(names, name, ',');) {
+    if (name == "sse4.1")
+      cpu.sse41 = true;
+    else if (name == "avx2")
+      cpu.avx2 = true;
+    else if (name == "avx512bw")
+      cpu.avx512bw = true;
+    else if (name == "bmi2")
+      cpu.bmi2 = true;
+    else if (name == "popcnt")
+      cpu.popcnt = true;
+    else if (name != "none")
+      return false;
+  }
+  return true;
+}
+
+bool parse(int argc, char** argv, options& opt) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg   = argv[i];
+    bool        value = i + 1 < argc;
+    if (arg == "--quick")
+      opt.quick = true;
+    else if (arg == "--csv" && value)
+      opt.csv_path = argv[++i];
+    else if (arg == "--json" && value)
+      opt.json_path = argv[++i];
+    else if (arg == "--size" && value)
+      opt.size = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--min-bits" && value)
+      opt.min_bits = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--max-bits" && value)
+      opt.max_bits = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--cpu" && value) {
+      if (!parse_cpu(argv[++i], opt.cpu))
+        return false;
+    } else
+      return false;
+  }
+  return opt.size > 0;
+}
+
+void save(const nanobench::Bench& bench, const std::string& path,
+          const char* format) {
+  if (path.empty())
+    return;
+  std::ofstream out(path);
+  nanobench::render(format, bench, out);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  options opt;
+  if (!parse(argc, argv, opt)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--csv file] [--json file] [--size n] [--min-bits n]"
+                 " [--max-bits n] [--quick] [--cpu list]\n";
+    return EXIT_FAILURE;
+  }
+  tight_uint::set_cpu_features(opt.cpu);
+
+  nanobench::Bench bench;
+  bench.title("tight_uint")
+      .unit("value")
+      .batch(opt.size)
+      .minEpochTime(std::chrono::milliseconds(opt.quick ? 1 : 10));
+  if (opt.quick)
+    bench.epochs(3);
+
+  bench_std_vector(bench, opt);
+  for (size_t bits = opt.min_bits; bits <= std::min<size_t>(opt.max_bits, 63);
+       ++bits)
+    bench_baselines(bench, opt, bits);
+  bench_widths<uint8_t>(bench, opt, std::make_index_sequence<7>());
+  bench_widths<uint16_t>(bench, opt, std::make_index_sequence<15>());
+  bench_widths<uint32_t>(bench, opt, std::make_index_sequence<31>());
+  bench_widths<uint64_t>(bench, opt, std::make_index_sequence<63>());
+
+  save(bench, opt.csv_path, nanobench::templates::csv());
+  save(bench, opt.json_path, nanobench::templates::json());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <array>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <numeric>
+#include <ranges>
+#include <tight_uint/allocator.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+TEST(Allocator, Aligned) {
+  aligned_vector<11> array(std::views::iota(0u, 1000u));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(array.data()) % 64, 0);
+  array.insert(array.begin(), 5u);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(array.data()) % 64, 0);
+  ASSERT_EQ(array[0], 5u);
+  ASSERT_EQ(array[1000], 999u);
+
+  aligned_vector<7, uint8_t, 128> bytes(100, 3u);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(bytes.data()) % 128, 0);
+
+  // Views and bulk operations work with any allocator
+  span<11, const uint32_t> view(array);
+  std::vector<uint32_t>    values(10);
+  unpack(view, 1, values);
+  ASSERT_EQ(values[9], 9u);
+}
+
+TEST(Allocator, Pmr) {
+  std::array<std::byte, 4096>         buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  pmr::vector<11> array(100, 7u, &arena);
+  pmr::vector<11> other({1, 2, 3}, &arena);
+  ASSERT_EQ(array.get_allocator().resource(), &arena);
+  auto inside = [&](const uint8_t* p) {
+    auto first = reinterpret_cast<const uint8_t*>(buffer.data());
+    return p >= first && p < first + buffer.size();
+  };
+  ASSERT_TRUE(inside(array.data()));
+  ASSERT_TRUE(inside(other.data()));
+  ASSERT_EQ(array[99], 7u);
+  ASSERT_EQ(other[2], 3u);
+
+  // The arena has no upstream, so exhausting it throws
+  ASSERT_THROW(array.resize(100000), std::bad_alloc);
+}
+
+TEST(Allocator, HugePage) {
+  huge_page_vector<11> small(10, 1u);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(small.data()) % 64, 0);
+
+  huge_page_vector<11> large(2000000);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(large.data()) %
+                huge_page_allocator<uint32_t>::s_page_bytes,
+            0);
+  large.back() = 2047u;
+  ASSERT_EQ(large[1999999], 2047u);
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <tight_uint/tight_uint.hpp>
+#include <type_traits>
+#include <vector>
+
+using namespace tight_uint;
+
+namespace {
+
+// Built entirely at compile time
+constexpr array<11, 100> make_squares() {
+  array<11, 100> result;
+  for (uint32_t i = 0; i < result.size(); ++i)
+    result[i] = i * i % 2048;
+  return result;
+}
+
+constexpr array<11, 100> s_squares = make_squares();
+
+struct record {
+  uint32_t             id;
+  array<5, 6>          small; // 30 bits in one word
+  array<7, 9, uint8_t> bytes;
+};
+
+} // namespace
+
+static_assert(std::is_trivially_copyable_v<array<11, 100>>);
+static_assert(sizeof(array<11, 32>) == 11 * sizeof(uint32_t));
+static_assert(sizeof(array<5, 6>) == sizeof(uint32_t));
+static_assert(s_squares[0] == 0);
+static_assert(s_squares[45] == 45 * 45 % 2048);
+static_assert(s_squares.back() == 99 * 99 % 2048);
+static_assert(array<3, 4, uint8_t>{1, 2, 3, 7}[3] == 7);
+static_assert(array<3, 4, uint8_t>{1, 2} == array<3, 4, uint8_t>{1, 2, 0});
+static_assert([] {
+  array<11, 50> values;
+  values.fill(1234);
+  return values[0] == 1234 && values[49] == 1234;
+}());
+
+TEST(Array, Constexpr) {
+  for (uint32_t i = 0; i < s_squares.size(); ++i)
+    ASSERT_EQ(s_squares[i], i * i % 2048) << "Index " << i;
+}
+
+TEST(Array, Access) {
+  array<13, 10, uint16_t> values{1, 2, 3};
+  ASSERT_EQ(values.size(), 10);
+  ASSERT_EQ(values[2], 3);
+  ASSERT_EQ(values[3], 0);
+  values.fill(8191);
+  ASSERT_TRUE(
+      std::ranges::all_of(values, [](uint16_t v) { return v == 8191; }));
+  values.back() = 5;
+  ASSERT_EQ(values[9], 5);
+  ASSERT_EQ(values.end() - values.begin(), 10);
+  ASSERT_THROW((array<3, 2>{1, 2, 3}), std::out_of_range);
+}
+
+TEST(Array, Record) {
+  record a{42, {1, 2, 31}, {127}};
+  record b = a;
+  b.small[1] = 30;
+  ASSERT_EQ(a.small[1], 2u);
+  ASSERT_EQ(b.small[1], 30u);
+  ASSERT_EQ(b.small[2], 31u);
+  ASSERT_EQ(b.bytes[0], 127);
+}
+
+TEST(Array, Span) {
+  array<11, 50> values;
+  std::ranges::copy(std::views::iota(0u, 50u), values.begin());
+  span<11, const uint32_t> view(values);
+  ASSERT_EQ(view.size(), 50);
+  std::vector<uint32_t> out(50);
+  unpack(view, 0, out);
+  ASSERT_EQ(out[49], 49u);
+  span<11, uint32_t> writable(values);
+  writable[10] = 1000u;
+  ASSERT_EQ(values[10], 1000u);
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <tight_uint/atomic.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+static_assert(std::ranges::random_access_range<atomic_span<11, uint32_t>>);
+static_assert(!atomic_uint_value<std::span<uint32_t>::iterator,
+                                 11>::is_always_atomic);
+static_assert(atomic_uint_value<std::span<uint32_t>::iterator,
+                                8>::is_always_atomic);
+
+TEST(Atomic, ReadWrite) {
+  std::vector<uint32_t>    memory(11);
+  atomic_span<11, uint32_t> array(memory);
+  ASSERT_EQ(array.size(), 32);
+  for (uint32_t i = 0; i < 32; ++i)
+    array[i] = i * 61u;
+  span<11, const uint32_t> plain(memory);
+  for (uint32_t i = 0; i < 32; ++i) {
+    ASSERT_EQ(array[i], i * 61u) << "Index " << i;
+    ASSERT_EQ(plain[i], i * 61u) << "Index " << i;
+  }
+}
+
+TEST(Atomic, FromVector) {
+  vector<13, uint64_t> container(100);
+  auto                 array = make_atomic_span(container);
+  ASSERT_EQ(array.size(), 100);
+  array[99] = 8191u;
+  ASSERT_EQ(container[99], 8191u);
+}
+
+template <size_t bits, class T>
+void testInterleavedWrites() {
+  // Each thread writes every n-th value, so every word is shared and values
+  // straddling words are written by different threads than their neighbours
+  constexpr unsigned threads = 8;
+  constexpr size_t   size    = 4096;
+  vector<bits, T>    container(size);
+  auto               array = make_atomic_span(container);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&array, t] {
+      for (unsigned repeat = 0; repeat < 16; ++repeat)
+        for (size_t i = t; i < size; i += threads)
+          array[i] = static_cast<T>(i + repeat);
+    });
+  }
+  for (auto& worker : workers)
+    worker.join();
+  const T mask = static_cast<T>((T(1) << bits) - 1);
+  for (size_t i = 0; i < size; ++i)
+    ASSERT_EQ(container[i], static_cast<T>(i + 15) & mask) << "Index " << i;
+}
+
+TEST(Atomic, InterleavedWrites) {
+  testInterleavedWrites<11, uint32_t>();
+  testInterleavedWrites<3, uint8_t>();
+  testInterleavedWrites<13, uint64_t>();
+}
@@ -40,6 +40,23 @@ TEST(Benchmark, CompareMicromesh) {
 
   assert(sum0 == sum1);
 
+  uint64_t sum2 = 0;
+  nanobench::Bench().minEpochTime(std::chrono::milliseconds(10)).run("sum tight_uint::sum<11>", [&] {
+    sum2 += tight_uint::sum(source0);
+    ankerl::nanobench::doNotOptimizeAway(sum2);
+  });
+
+  std::vector<uint32_t> unpacked(source0.size());
+  nanobench::Bench().minEpochTime(std::chrono::milliseconds(10)).run("unpack packed_uintn<11>", [&] {
+    unpack(source0, 0, unpacked);
+    ankerl::nanobench::doNotOptimizeAway(unpacked.data());
+  });
+
+  nanobench::Bench().minEpochTime(std::chrono::milliseconds(10)).run("pack packed_uintn<11>", [&] {
+    source0.assign(unpacked.begin(), unpacked.end());
+    ankerl::nanobench::doNotOptimizeAway(source0.data());
+  });
+
   sum0 = 0;
   nanobench::Bench().minEpochTime(std::chrono::milliseconds(10)).run("fill packed_uintn<11>", [&] {
     // std::fill(source0.begin(), source0.end(), 2047u);
@@ -0,0 +1,128 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <gtest/gtest.h>
+#include <random>
+#include <tight_uint/bitvector.hpp>
+#include <tight_uint/scan.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+namespace {
+
+// Bits set with the given probability, as a bitvector and as bools
+std::pair<bitvector, std::vector<bool>> make_bits(size_t size,
+                                                  double density,
+                                                  unsigned seed) {
+  std::mt19937                rng(seed);
+  std::bernoulli_distribution bit(density);
+  bitvector                   bits(size);
+  std::vector<bool>           expected(size);
+  for (size_t i = 0; i < size; ++i)
+    if ((expected[i] = bit(rng)))
+      bits.set(i);
+  return {std::move(bits), expected};
+}
+
+} // namespace
+
+TEST(Bitvector, Basic) {
+  bitvector bits(130);
+  EXPECT_TRUE(bits.none());
+  EXPECT_EQ(bits.find_first(), 130u);
+  bits.set(3);
+  bits.set(64);
+  bits.set(129);
+  EXPECT_TRUE(bits[3] && bits.test(64) && bits[129]);
+  EXPECT_FALSE(bits[4]);
+  EXPECT_EQ(bits.count(), 3u);
+  EXPECT_EQ(bits.find_first(), 3u);
+  EXPECT_EQ(bits.find_next(3), 64u);
+  EXPECT_EQ(bits.find_next(64), 129u);
+  EXPECT_EQ(bits.find_next(129), 130u);
+  std::vector<size_t> set;
+  for (size_t i : bits.set_bits())
+    set.push_back(i);
+  EXPECT_EQ(set, (std::vector<size_t>{3, 64, 129}));
+  bits.reset(64);
+  bits.flip(5);
+  EXPECT_EQ(bits.count(), 3u);
+  EXPECT_EQ(bits.view()[5], 1u);
+
+  // Flipping keeps the bits past the end clear
+  bitvector inverted = ~bits;
+  EXPECT_EQ(inverted.count(), 127u);
+  EXPECT_EQ(inverted.words().back() >> 2, 0u);
+  EXPECT_EQ(~inverted, bits);
+
+  bits.resize(200, true);
+  EXPECT_EQ(bits.count(), 73u);
+  bits.push_back(false);
+  EXPECT_EQ(bits.size(), 201u);
+  EXPECT_FALSE(bits[200]);
+  EXPECT_EQ(bitvector(70, true).count(), 70u);
+}
+
+TEST(Bitvector, WordOperations) {
+  auto [a, a_bits] = make_bits(1000, 0.5, 1);
+  auto [b, b_bits] = make_bits(1000, 0.3, 2);
+  bitvector both   = a & b;
+  bitvector either = a | b;
+  bitvector one    = a ^ b;
+  bitvector only_a = a;
+  only_a.and_not(b);
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(both[i], a_bits[i] && b_bits[i]);
+    EXPECT_EQ(either[i], a_bits[i] || b_bits[i]);
+    EXPECT_EQ(one[i], a_bits[i] != b_bits[i]);
+    EXPECT_EQ(only_a[i], a_bits[i] && !b_bits[i]);
+  }
+  EXPECT_EQ(both.count() + either.count(), a.count() + b.count());
+  EXPECT_THROW(a &= bitvector(999), std::invalid_argument);
+
+  std::vector<size_t> indices;
+  for (size_t i : a.set_bits())
+    indices.push_back(i);
+  ASSERT_EQ(indices.size(), a.count());
+  for (size_t i = 0, j = a.find_first(); i < indices.size();
+       ++i, j = a.find_next(j))
+    EXPECT_EQ(indices[i], j);
+}
+
+TEST(Bitvector, FromScan) {
+  vector<5> column(300);
+  for (uint32_t i = 0; i < column.size(); ++i)
+    column[i] = i % 32;
+  vector<1, uint64_t> selection(column.size());
+  scan_lt(column, 8u, selection);
+  bitvector filter(std::move(selection));
+  EXPECT_EQ(filter.count(), 300u / 32 * 8 + 8);
+  EXPECT_EQ(filter.find_next(7), 32u);
+}
+
+TEST(RankSelect, Random) {
+  for (double density : {0.0, 0.001, 0.1, 0.5, 0.99, 1.0}) {
+    for (size_t size : {0, 1, 64, 511, 512, 513, 5000, 70000}) {
+      auto [bits, expected] = make_bits(size, density, unsigned(size));
+      rank_select index(bits);
+      ASSERT_EQ(index.count(), bits.count());
+      ASSERT_EQ(index.size(), size);
+      size_t ones = 0;
+      for (size_t i = 0; i <= size; ++i) {
+        ASSERT_EQ(index.rank1(i), ones) << size << " " << i;
+        ASSERT_EQ(index.rank0(i), i - ones);
+        if (i < size && expected[i]) {
+          ASSERT_EQ(index.select1(ones++), i) << size << " " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(RankSelect, IgnoresBitsPastSize) {
+  std::vector<uint64_t> words = {~uint64_t(0), ~uint64_t(0)};
+  rank_select           index(span<1, const uint64_t>(words, 70));
+  EXPECT_EQ(index.count(), 70u);
+  EXPECT_EQ(index.rank1(70), 70u);
+  EXPECT_EQ(index.select1(69), 69u);
+}
@@ -0,0 +1,222 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <tight_uint/bitvector.hpp>
+#include <tight_uint/cpu.hpp>
+#include <tight_uint/encoding.hpp>
+#include <tight_uint/scan.hpp>
+#include <type_traits>
+#include <vector>
+#include "test_values.h"
+
+using namespace tight_uint;
+
+namespace {
+
+// Runs f once with each set of kernels this CPU can run, from scalar only to
+// everything, then restores the detected features
+template <class Function>
+void forEachCpu(Function&& f) {
+  cpu_features detected = detect_cpu_features();
+  for (cpu_features features : {cpu_features{},
+                                cpu_features{.sse41 = true},
+                                cpu_features{.sse41 = true, .avx2 = true},
+                                cpu_features{.sse41    = true,
+                                             .avx2     = true,
+                                             .avx512bw = true},
+                                cpu_features{.bmi2 = true},
+                                cpu_features{.popcnt = true},
+                                detected}) {
+    set_cpu_features(features);
+    SCOPED_TRACE(testing::Message()
+                 << "sse4.1 " << cpu().sse41 << ", avx2 " << cpu().avx2
+                 << ", avx512bw " << cpu().avx512bw << ", bmi2 "
+                 << cpu().bmi2 << ", popcnt " << cpu().popcnt);
+    f();
+  }
+  set_cpu_features(detected);
+  EXPECT_EQ(cpu(), detected);
+}
+
+// Kernels are also chosen by the decoded type: SIMD decodes to uint32_t and
+// BMI2 to uint8_t and uint16_t
+template <size_t bits>
+using least_uint = std::conditional_t<
+    bits <= 8, uint8_t,
+    std::conditional_t<bits <= 16, uint16_t,
+                       std::conditional_t<bits <= 32, uint32_t, uint64_t>>>;
+
+template <size_t bits, class T, class Out>
+void testUnpackKernels() {
+  const vector<bits, T> array(sample_values<T>(300, bits));
+  for (size_t first : {0, 1, 3, 7}) {
+    std::vector<Out> values(array.size() - first);
+    detail::unpack_bits<bits>(std::to_address(array.begin().base()),
+                              first * bits, values.size(), values.data());
+    for (size_t i = 0; i < values.size(); ++i)
+      ASSERT_EQ(values[i], array[first + i]) << "i " << i;
+  }
+}
+
+template <size_t bits, class T, class In>
+void testPackKernels() {
+  const T mask = static_cast<T>((uint64_t(1) << bits) - 1);
+  for (size_t first : {0, 1, 3, 7}) {
+    // Neighbouring values must be preserved
+    vector<bits, T> array(300, mask);
+    std::vector<In> values =
+        sample_values<In>(array.size() - first - 2, sizeof(In) * 8);
+    detail::pack_bits<bits>(std::to_address(array.begin().base()),
+                            first * bits, values.size(), values.data());
+    for (size_t i = 0; i < array.size(); ++i) {
+      T expected = i >= first && i < first + values.size()
+                       ? static_cast<T>(values[i - first] & mask)
+                       : mask;
+      ASSERT_EQ(array[i], expected) << "i " << i;
+    }
+  }
+}
+
+} // namespace
+
+TEST(Cpu, Detected) {
+  cpu_features features = detect_cpu_features();
+  EXPECT_EQ(cpu(), features);
+  // Later extensions imply the earlier ones on every real CPU
+  EXPECT_TRUE(!features.avx512bw || features.avx2);
+  EXPECT_TRUE(!features.avx2 || features.sse41);
+}
+
+TEST(Cpu, SetFeatures) {
+  cpu_features detected = detect_cpu_features();
+  set_cpu_features({});
+  EXPECT_EQ(cpu(), cpu_features{});
+  // Features the CPU lacks stay off
+  set_cpu_features({true, true, true, true, true});
+  EXPECT_EQ(cpu(), detected);
+}
+
+template <class Width>
+class CpuBulk : public testing::Test {};
+TYPED_TEST_SUITE(CpuBulk, bulk_widths);
+
+TYPED_TEST(CpuBulk, Unpack) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  forEachCpu([] {
+    testUnpackKernels<bits, T, T>();
+    testUnpackKernels<bits, T, least_uint<bits>>();
+    if constexpr (bits <= 32)
+      testUnpackKernels<bits, T, uint32_t>();
+  });
+}
+
+TYPED_TEST(CpuBulk, Pack) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  forEachCpu([] {
+    testPackKernels<bits, T, T>();
+    testPackKernels<bits, T, least_uint<bits>>();
+    if constexpr (bits <= 32)
+      testPackKernels<bits, T, uint32_t>();
+  });
+}
+
+TYPED_TEST(CpuBulk, Gather) {
+  constexpr size_t      bits = TypeParam::bits;
+  using T                    = typename TypeParam::type;
+  const vector<bits, T> array(sample_values<T>(1000, bits));
+  std::vector<size_t>   indices;
+  for (size_t i = 0; i < 100; ++i)
+    indices.push_back(i * 7919 % array.size());
+  for (size_t i = 0; i < 9; ++i)
+    indices.push_back(array.size() - 1 - i);
+  forEachCpu([&] {
+    std::vector<T> values(indices.size());
+    gather(array, indices, values);
+    for (size_t i = 0; i < indices.size(); ++i)
+      ASSERT_EQ(values[i], array[indices[i]]) << "i " << i;
+  });
+}
+
+TYPED_TEST(CpuBulk, Scan) {
+  constexpr size_t      bits = TypeParam::bits;
+  using T                    = typename TypeParam::type;
+  const vector<bits, T> array(sample_values<T>(1000, bits));
+  const T               hi = static_cast<T>(((uint64_t(1) << bits) - 1) / 2);
+  std::vector<size_t>   expected;
+  for (size_t i = 0; i < array.size(); ++i)
+    if (1 <= array[i] && array[i] <= hi)
+      expected.push_back(i);
+  forEachCpu([&] {
+    std::vector<size_t> indices;
+    scan_between(array, T(1), hi, indices);
+    ASSERT_EQ(indices, expected);
+  });
+}
+
+TYPED_TEST(CpuBulk, PopcountSum) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  // Only the narrowest widths sum bit planes with popcount
+  if constexpr (bits <= 3) {
+    const vector<bits, T> array(sample_values<T>(1000, bits));
+    const uint64_t        expected =
+        std::accumulate(array.begin(), array.end(), uint64_t(0));
+    const cpu_features detected = detect_cpu_features();
+    set_cpu_features({});
+    EXPECT_EQ(detail::popcount_sum_bits(), 2);
+    EXPECT_EQ(sum(array), expected);
+    set_cpu_features({.popcnt = true});
+    EXPECT_EQ(detail::popcount_sum_bits(), detected.popcnt ? 3 : 2);
+    EXPECT_EQ(sum(array), expected);
+    set_cpu_features(detected);
+
+    // Both bit plane counts agree
+    const T*     words  = std::to_address(array.begin().base());
+    const size_t groups = array.size() / detail::group_values<bits, T>;
+    std::vector<uint64_t> plain(bits), fast(bits);
+    detail::count_planes<bits>(words, groups, plain.data());
+#if defined(TIGHT_UINT_POPCNT)
+    if (detected.popcnt) {
+      detail::count_planes_popcnt<bits>(words, groups, fast.data());
+      EXPECT_EQ(plain, fast);
+    }
+#endif
+  }
+}
+
+TEST(Cpu, Sum) {
+  // Narrow widths sum bit planes with popcount
+  const vector<3, uint8_t> narrow(sample_values<uint8_t>(1000, 3));
+  const vector<2>          narrower(sample_values<uint32_t>(1000, 2));
+  forEachCpu([&] {
+    ASSERT_EQ(sum(narrow),
+              std::accumulate(narrow.begin(), narrow.end(), uint64_t(0)));
+    ASSERT_EQ(sum(narrower),
+              std::accumulate(narrower.begin(), narrower.end(), uint64_t(0)));
+  });
+}
+
+TEST(Cpu, Select) {
+  bitvector bits(5000);
+  for (size_t i = 0; i < bits.size(); i += i % 7 + 1)
+    bits.set(i);
+  rank_select index(bits);
+  forEachCpu([&] {
+    size_t k = 0;
+    for (size_t i : bits.set_bits())
+      ASSERT_EQ(index.select1(k++), i);
+  });
+}
+
+TEST(Cpu, PrefixSum) {
+  std::vector<uint32_t> values(1000);
+  for (uint32_t i = 0; i < values.size(); ++i)
+    values[i] = i * 3 + i % 2;
+  forEachCpu([&] {
+    delta_vector<uint32_t> column(values, 64);
+    ASSERT_TRUE(std::ranges::equal(column.decode(), values));
+  });
+}
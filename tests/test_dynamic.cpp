@@ -0,0 +1,130 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <tight_uint/dynamic.hpp>
+#include <vector>
+#include "test_values.h"
+
+using namespace tight_uint;
+
+static_assert(std::ranges::random_access_range<dynamic_vector<uint32_t>>);
+static_assert(std::ranges::random_access_range<dynamic_span<uint32_t>>);
+
+TEST(Dynamic, Dispatch) {
+  ASSERT_EQ(dispatch_bits<uint32_t>(11, [](auto bits) { return bits(); }), 11);
+  ASSERT_EQ(dispatch_bits<uint64_t>(63, [](auto bits) { return bits(); }), 63);
+  ASSERT_THROW(dispatch_bits<uint32_t>(32, [](auto) {}), std::invalid_argument);
+  ASSERT_THROW(dynamic_vector<uint32_t>(0), std::invalid_argument);
+}
+
+TEST(Dynamic, ReadWrite) {
+  for (size_t bits = 1; bits < 32; ++bits) {
+    dynamic_vector<uint32_t> array(bits, 100);
+    ASSERT_EQ(array.bits(), bits);
+    ASSERT_EQ(array.size_bytes(), (100 * bits + 31) / 32 * 4);
+    // Bits above the width are dropped
+    const std::vector<uint32_t> values = sample_values<uint32_t>(100, 32);
+    const uint32_t              mask   = (1u << bits) - 1;
+    for (size_t i = 0; i < values.size(); ++i)
+      array[i] = values[i];
+    for (size_t i = 0; i < values.size(); ++i)
+      ASSERT_EQ(array[i], values[i] & mask) << "Bits " << bits;
+  }
+}
+
+TEST(Dynamic, SameLayoutAsVector) {
+  vector<13, uint64_t> typed(std::views::iota(0u, 200u));
+  dynamic_span<uint64_t> view(span<13, uint64_t>{typed});
+  ASSERT_EQ(view.size(), 200);
+  for (uint32_t i = 0; i < 200; ++i)
+    ASSERT_EQ(view[i], i);
+  auto it = std::find(view.begin(), view.end(), 150u);
+  ASSERT_EQ(it - view.begin(), 150);
+}
+
+TEST(Dynamic, Bulk) {
+  std::vector<uint32_t> values(1000);
+  std::iota(values.begin(), values.end(), 0u);
+  dynamic_vector<uint32_t> array(11, values);
+  ASSERT_EQ(array.size(), 1000);
+
+  std::vector<uint32_t> unpacked(990);
+  unpack(array, 10, unpacked);
+  for (uint32_t i = 0; i < unpacked.size(); ++i)
+    ASSERT_EQ(unpacked[i], i + 10);
+
+  ASSERT_EQ(reduce(array, uint64_t(0)), 999u * 1000u / 2u);
+  ASSERT_EQ(sum(array), 999u * 1000u / 2u);
+  ASSERT_EQ(min_max(array).min, 0u);
+  ASSERT_EQ(min_max(array).max, 999u);
+  ASSERT_EQ(count(array, 7u), 1);
+  std::vector<size_t> counts(2048);
+  histogram(array, counts);
+  ASSERT_EQ(counts[999], 1);
+  ASSERT_EQ(counts[1000], 0);
+
+  std::vector<size_t>   indices{999, 0, 512, 7};
+  std::vector<uint32_t> gathered(indices.size());
+  gather(array, indices, gathered);
+  ASSERT_EQ(gathered, (std::vector<uint32_t>{999, 0, 512, 7}));
+  ASSERT_THROW(gather(array, indices, std::span(gathered).first(3)),
+               std::invalid_argument);
+
+  std::vector<uint32_t> updates{1, 2, 3, 4};
+  ASSERT_THROW(scatter(array, indices, std::span(updates).first(3)),
+               std::invalid_argument);
+  scatter(array, indices, updates, scatter_order::by_word);
+  ASSERT_EQ(array[999], 1u);
+  ASSERT_EQ(array[0], 2u);
+  ASSERT_EQ(array[512], 3u);
+  ASSERT_EQ(array[7], 4u);
+  ASSERT_EQ(array[8], 8u);
+
+  fill(array, 2047u);
+  ASSERT_EQ(reduce(array, uint64_t(0)), 2047u * 1000u);
+}
+
+TEST(Dynamic, FillConstruct) {
+  dynamic_vector<uint16_t> array(5, 33, 17u);
+  for (auto value : array)
+    ASSERT_EQ(value, 17u);
+  array.push_back(31u);
+  ASSERT_EQ(array.size(), 34);
+  ASSERT_EQ(array[33], 31u);
+}
+
+TEST(Dynamic, Resize) {
+  dynamic_vector<uint32_t> array(11, 10, 2047u);
+  array.resize(3);
+  array.resize(5);
+  ASSERT_EQ(array[2], 2047u);
+  ASSERT_EQ(array[3], 0u);
+  ASSERT_EQ(array[4], 0u);
+
+  // The words match a vector that never held the old values
+  dynamic_vector<uint32_t> expected(11, 5);
+  for (size_t i = 0; i < 3; ++i)
+    expected[i] = 2047u;
+  ASSERT_EQ(array.size_bytes(), expected.size_bytes());
+  ASSERT_EQ(std::memcmp(array.data(), expected.data(), array.size_bytes()), 0);
+}
+
+TEST(Dynamic, Transcode) {
+  std::vector<uint32_t> values(1000);
+  std::iota(values.begin(), values.end(), 0u);
+  dynamic_vector<uint32_t> wide(16, values);
+  dynamic_vector<uint64_t> narrow(9, values.size());
+  ASSERT_THROW(transcode(wide, narrow), std::out_of_range);
+  transcode(wide, narrow, narrowing::unchecked);
+  ASSERT_EQ(narrow[511], 511u);
+  ASSERT_EQ(narrow[999], 999u - 512u);
+
+  dynamic_vector<uint32_t> widened(13, values.size());
+  transcode(wide, widened);
+  ASSERT_EQ(reduce(widened, uint64_t(0)), 999u * 1000u / 2u);
+
+  dynamic_vector<uint32_t> small(13, values.size() - 1);
+  ASSERT_THROW(transcode(wide, small), std::invalid_argument);
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include <tight_uint/encoding.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+TEST(Encoding, FrameOfReference) {
+  std::vector<uint32_t> values{1000000, 1000100, 1000003, 1000255, 1000000};
+  frame_of_reference<uint32_t> column(values);
+  ASSERT_EQ(column.base(), 1000000u);
+  ASSERT_EQ(column.bits(), 8);
+  ASSERT_EQ(column.size(), values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    ASSERT_EQ(column[i], values[i]) << "Index " << i;
+  ASSERT_EQ(column.decode(), values);
+
+  std::vector<uint32_t> tail(3);
+  column.unpack(2, tail);
+  ASSERT_EQ(tail, (std::vector<uint32_t>{1000003, 1000255, 1000000}));
+}
+
+TEST(Encoding, FrameOfReferenceConstant) {
+  std::vector<uint64_t>        values(10, 42);
+  frame_of_reference<uint64_t> column(values);
+  ASSERT_EQ(column.bits(), 1);
+  ASSERT_EQ(column.decode(), values);
+  ASSERT_EQ(frame_of_reference<uint32_t>(std::vector<uint32_t>{}).size(), 0);
+}
+
+TEST(Encoding, FrameOfReferenceTooWide) {
+  std::vector<uint32_t> values{0, 0xffffffffu};
+  ASSERT_THROW(frame_of_reference<uint32_t>{values}, std::invalid_argument);
+
+  // One bit narrower fits, and a wider word type holds the full range
+  values[1] = 0x7fffffffu;
+  ASSERT_EQ(frame_of_reference<uint32_t>(values).bits(), 31);
+  std::vector<uint64_t> wide{0, 0xffffffffu};
+  ASSERT_EQ(frame_of_reference<uint64_t>(wide).decode(), wide);
+}
+
+TEST(Encoding, Delta) {
+  std::mt19937                            gen(1234);
+  std::uniform_int_distribution<uint32_t> step(0, 50);
+  std::vector<uint32_t>                   values(1000);
+  uint32_t                                value = 3000000000u;
+  for (auto& v : values)
+    v = value += step(gen);
+
+  delta_vector<uint32_t> column(values, 64);
+  ASSERT_EQ(column.size(), values.size());
+  ASSERT_EQ(column.bits(), 6);
+  ASSERT_LT(column.size_bytes(), values.size() * sizeof(uint32_t) / 4);
+  for (size_t i = 0; i < values.size(); ++i)
+    ASSERT_EQ(column[i], values[i]) << "Index " << i;
+  ASSERT_EQ(column.decode(), values);
+
+  // Start mid block and cross several checkpoints
+  std::vector<uint32_t> part(300);
+  column.unpack(37, part);
+  for (size_t i = 0; i < part.size(); ++i)
+    ASSERT_EQ(part[i], values[37 + i]) << "Index " << 37 + i;
+}
+
+TEST(Encoding, DeltaUnsorted) {
+  std::vector<uint32_t> values{3, 2, 1};
+  ASSERT_THROW(delta_vector<uint32_t>{values}, std::invalid_argument);
+}
+
+TEST(Encoding, DeltaTooWide) {
+  std::vector<uint32_t> values{0, 0xffffffffu};
+  ASSERT_THROW(delta_vector<uint32_t>{values}, std::invalid_argument);
+  values[1] = 0x7fffffffu;
+  ASSERT_EQ(delta_vector<uint32_t>(values).decode(), values);
+}
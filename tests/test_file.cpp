@@ -0,0 +1,129 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tight_uint/file.hpp>
+
+using namespace tight_uint;
+
+namespace {
+
+// Removes the file when the test ends
+struct temp_file {
+  std::filesystem::path path;
+  explicit temp_file(const char* name)
+      : path(std::filesystem::temp_directory_path() / name) {}
+  ~temp_file() { std::filesystem::remove(path); }
+};
+
+vector<11> make_values(size_t size) {
+  vector<11> result(size);
+  for (size_t i = 0; i < size; ++i)
+    result[i] = static_cast<uint32_t>(i * 37);
+  return result;
+}
+
+} // namespace
+
+TEST(File, StreamRoundTrip) {
+  vector<11>        values = make_values(1000);
+  std::stringstream stream;
+  write(stream, values);
+  ASSERT_EQ(stream.str().size(),
+            file_header::s_data_offset + values.size_bytes());
+  vector<11> result = read<11>(stream);
+  ASSERT_EQ(result.size(), values.size());
+  ASSERT_TRUE(std::ranges::equal(result, values));
+}
+
+TEST(File, Mismatch) {
+  std::stringstream stream;
+  write(stream, make_values(10));
+  std::string data = stream.str();
+
+  std::stringstream wrong_bits(data);
+  ASSERT_THROW((read<12>(wrong_bits)), std::runtime_error);
+  std::stringstream wrong_word(data);
+  ASSERT_THROW((read<11, uint64_t>(wrong_word)), std::runtime_error);
+  data[0] = 'X';
+  std::stringstream wrong_magic(data);
+  ASSERT_THROW((read<11>(wrong_magic)), std::runtime_error);
+}
+
+TEST(File, CorruptHeader) {
+  std::stringstream stream;
+  write(stream, make_values(10));
+  const std::string data = stream.str();
+  auto corrupt = [&](size_t offset, uint64_t value) {
+    std::string result = data;
+    std::memcpy(result.data() + offset, &value, sizeof(value));
+    return result;
+  };
+
+  // size * bits wraps around to a few bits
+  std::stringstream huge_size(
+      corrupt(offsetof(file_header, size), UINT64_MAX / 11 + 1));
+  ASSERT_THROW((read<11>(huge_size)), std::runtime_error);
+  std::stringstream misaligned(
+      corrupt(offsetof(file_header, data_offset), 65));
+  ASSERT_THROW((read<11>(misaligned)), std::runtime_error);
+
+#ifdef TIGHT_UINT_HAS_MMAP
+  // data_offset + data_bytes wraps around to within the file
+  temp_file file("tight_uint_test_corrupt.bin");
+  std::ofstream(file.path, std::ios::binary)
+      << corrupt(offsetof(file_header, data_offset), uint64_t(0) - 64);
+  ASSERT_THROW((mapped_span<11, const uint32_t>(file.path)),
+               std::runtime_error);
+#endif
+}
+
+#ifdef TIGHT_UINT_HAS_MMAP
+
+TEST(File, MappedReadOnly) {
+  temp_file  file("tight_uint_test_read.bin");
+  vector<11> values = make_values(1000);
+  write(file.path, values);
+
+  mapped_span<11, const uint32_t> mapped(file.path);
+  ASSERT_EQ(mapped.header().bits, 11);
+  ASSERT_EQ(mapped.size(), values.size());
+  ASSERT_TRUE(std::ranges::equal(mapped, values));
+
+  // Data is aligned for SIMD loads
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(mapped.data()) % 64, 0);
+
+  ASSERT_THROW((mapped_span<12, const uint32_t>(file.path)),
+               std::runtime_error);
+  ASSERT_THROW((mapped_span<11, const uint32_t>("does/not/exist")),
+               std::runtime_error);
+}
+
+TEST(File, MappedReadWrite) {
+  temp_file file("tight_uint_test_write.bin");
+  write(file.path, make_values(100));
+  {
+    mapped_span<11, uint32_t> mapped(file.path);
+    mapped[42] = 1234u;
+  }
+  vector<11> result = read<11>(file.path);
+  ASSERT_EQ(result[42], 1234u);
+  ASSERT_EQ(result[41], 41u * 37u);
+  ASSERT_EQ(result[43], 43u * 37u);
+}
+
+TEST(File, MappedDynamic) {
+  temp_file file("tight_uint_test_dynamic.bin");
+  write(file.path, make_values(100));
+  mapped_dynamic_span<const uint32_t> mapped(file.path);
+  ASSERT_EQ(mapped.bits(), 11);
+  ASSERT_EQ(mapped.size(), 100);
+  ASSERT_EQ(mapped[50], 50u * 37u);
+}
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <ranges>
+#include <tight_uint/groups.hpp>
+
+using namespace tight_uint;
+
+static_assert(group<11, uint32_t>::size == 32);
+static_assert(group<11, uint32_t>::words == 11);
+static_assert(group<13, uint64_t>::size == 64);
+static_assert(group<3, uint8_t>::words == 3);
+static_assert(std::ranges::random_access_range<group_view<11, uint32_t>>);
+
+TEST(Groups, Values) {
+  vector<11> array(std::views::iota(0u, 100u));
+  auto       view = groups(array);
+  ASSERT_EQ(view.size(), 3);
+  ASSERT_TRUE(view.head().empty());
+  ASSERT_EQ(view.tail().size(), 4);
+  uint32_t i = 0;
+  for (auto group : view) {
+    for (auto value : group.values())
+      ASSERT_EQ(value, i++);
+  }
+  for (auto value : view.tail())
+    ASSERT_EQ(value, i++);
+  ASSERT_EQ(view[2].get<5>(), 69u);
+}
+
+TEST(Groups, ForEach) {
+  const vector<13, uint64_t> array(std::views::iota(0u, 640u));
+  uint64_t                   sum = 0;
+  for (auto group : groups(array))
+    group.for_each([&sum](uint64_t value) { sum += value; });
+  ASSERT_EQ(sum, 639u * 640u / 2u);
+}
+
+TEST(Groups, Transform) {
+  vector<7, uint8_t> array(std::views::iota(0u, 100u));
+  auto               view = groups(array);
+  for (auto group : view)
+    group.transform([](uint8_t value) { return value + 1; });
+  for (auto&& value : view.tail())
+    value = value + 1;
+  for (uint32_t i = 0; i < 100; ++i)
+    ASSERT_EQ(array[i], (i + 1) & 127u) << "Index " << i;
+}
+
+TEST(Groups, SubRange) {
+  vector<11> array(std::views::iota(0u, 200u));
+  auto       view = groups(span<11, uint32_t>(array), 5, 150);
+  ASSERT_EQ(view.head().size(), 27);
+  ASSERT_EQ(view.size(), 3);
+  ASSERT_EQ(view.tail().size(), 22);
+  ASSERT_EQ(*view.head().begin(), 5u);
+  ASSERT_EQ(view[0].get<0>(), 32u);
+  ASSERT_EQ(*view.tail().begin(), 128u);
+
+  // Entirely within one group
+  auto small = groups(span<11, uint32_t>(array), 3, 9);
+  ASSERT_EQ(small.head().size() + small.tail().size(), 6);
+  ASSERT_EQ(small.size(), 0);
+}
@@ -4,8 +4,11 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <iterator>
+#include <numeric>
 #include <tight_uint/tight_uint.hpp>
 #include <ranges>
+#include <sstream>
+#include "test_values.h"
 
 using namespace tight_uint;
 
@@ -262,6 +265,541 @@ TEST(UnitTest, ReinterpretCopy) {
   ASSERT_EQ(copy[0], 2047u);
 }
 
+// The bulk kernels specialise on the width, so these run for each of
+// bulk_widths
+template <class Width>
+class Bulk : public testing::Test {};
+TYPED_TEST_SUITE(Bulk, bulk_widths);
+
+TYPED_TEST(Bulk, Unpack) {
+  constexpr size_t      bits = TypeParam::bits;
+  using T                    = typename TypeParam::type;
+  const vector<bits, T> array(sample_values<T>(1000, bits));
+  for (size_t first : {0, 1, 3, 7}) {
+    std::vector<T> values(array.size() - first);
+    unpack(array, first, values);
+    for (size_t i = 0; i < values.size(); ++i)
+      ASSERT_EQ(values[i], array[first + i]) << "Index " << first + i;
+  }
+}
+
+TEST(UnitTest, UnpackShort) {
+  // Exercises the scalar tail and the end-of-buffer bound on SIMD loads
+  for (size_t size = 1; size < 40; ++size) {
+    const vector<11>      array(sample_values<uint32_t>(size, 11));
+    std::vector<uint32_t> values(size);
+    unpack(array, 0, values);
+    ASSERT_TRUE(std::ranges::equal(values, array)) << "Size " << size;
+  }
+}
+
+TEST(UnitTest, CopyContiguous) {
+  const vector<11> array(std::views::iota(0u, 100u));
+  std::vector<uint32_t> values(100);
+  auto end = tight_uint::copy(array.begin(), array.end(), values.begin());
+  ASSERT_EQ(end, values.end());
+  for (uint32_t i = 0; i < 100; ++i)
+    ASSERT_EQ(values[i], i);
+}
+
+TEST(UnitTest, UnpackSpan) {
+  std::vector<uint32_t> memory(11);
+  std::ranges::copy(std::views::iota(0u, 32u),
+                    span<11, uint32_t>(memory).begin());
+  span<11, const uint32_t> array(memory);
+  std::vector<uint32_t>    values(30);
+  unpack(array, 2, values);
+  for (uint32_t i = 0; i < 30; ++i)
+    ASSERT_EQ(values[i], i + 2);
+}
+
+TYPED_TEST(Bulk, Pack) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  const T          mask = static_cast<T>((uint64_t(1) << bits) - 1);
+  // Bits above the width are dropped
+  const std::vector<T> values = sample_values<T>(990, sizeof(T) * 8);
+  for (size_t first : {0, 3, 7}) {
+    // Start with all bits set to check neighbours are preserved
+    std::vector<T> memory((1000 * bits + sizeof(T) * 8 - 1) / (sizeof(T) * 8),
+                          std::numeric_limits<T>::max());
+    span<bits, T>  array(memory);
+    pack(array, first, std::span<const T>(values));
+    for (size_t i = 0; i < array.size(); ++i) {
+      T expected = i >= first && i < first + values.size()
+                       ? static_cast<T>(values[i - first] & mask)
+                       : mask;
+      ASSERT_EQ(array[i], expected) << "Index " << i;
+    }
+  }
+}
+
+TEST(UnitTest, PackShort) {
+  const std::vector<uint32_t> values = sample_values<uint32_t>(40, 11);
+  for (size_t count = 0; count < 40; ++count) {
+    vector<11> array(64, 2047u);
+    pack(array, 5, std::span<const uint32_t>(values).first(count));
+    for (size_t i = 0; i < array.size(); ++i)
+      ASSERT_EQ(array[i], i >= 5 && i < 5 + count ? values[i - 5] : 2047u)
+          << "Count " << count << " index " << i;
+  }
+}
+
+TEST(UnitTest, FromContiguousRange) {
+  std::vector<uint32_t> values(1000);
+  std::iota(values.begin(), values.end(), 0u);
+  vector<11> array(values);
+  ASSERT_EQ(array.size(), 1000);
+  for (uint32_t i = 0; i < 1000; ++i)
+    ASSERT_EQ(array[i], i) << "Index " << i;
+}
+
+TEST(UnitTest, Append) {
+  vector<11> array{0, 1, 2};
+  std::vector<uint32_t>{3, 4, 5} | array;
+  std::views::iota(6u, 10u) | array;
+  ASSERT_EQ(array.size(), 10);
+  for (uint32_t i = 0; i < 10; ++i)
+    ASSERT_EQ(array[i], i) << "Index " << i;
+}
+
+TEST(UnitTest, Assign) {
+  vector<13> array(5, 123u);
+  std::vector<uint32_t> values{7, 8, 9};
+  array.assign(values.begin(), values.end());
+  ASSERT_EQ(array.size(), 3);
+  ASSERT_EQ(array[0], 7);
+  ASSERT_EQ(array[2], 9);
+  array.assign({1, 2});
+  ASSERT_EQ(array.size(), 2);
+  ASSERT_EQ(array[1], 2);
+}
+
+TEST(UnitTest, IteratorBackwards) {
+  vector<11> array(std::views::iota(0u, 100u));
+  auto       it = array.end() - 1;
+  ASSERT_EQ(*it, 99u);
+  it = it - 50;
+  ASSERT_EQ(*it, 49u);
+  --it;
+  ASSERT_EQ(*it, 48u);
+  ASSERT_EQ(array.end() - it, 52);
+  ASSERT_EQ(it - array.begin(), 48);
+  ASSERT_EQ(array.back(), 99u);
+}
+
+TEST(UnitTest, PopBack) {
+  vector<11> array{1, 2, 2047};
+  array.pop_back();
+  ASSERT_EQ(array.size(), 2);
+  ASSERT_EQ(array.back(), 2u);
+  // Bits past the end are cleared
+  array.resize(3);
+  ASSERT_EQ(array[2], 0u);
+  array.resize(1);
+  array.shrink_to_fit();
+  ASSERT_EQ(array.size_bytes(), 4);
+  ASSERT_EQ(array[0], 1u);
+}
+
+TYPED_TEST(Bulk, InsertErase) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  const T          mask = static_cast<T>((uint64_t(1) << bits) - 1);
+  vector<bits, T>  array;
+  std::vector<T>   expected;
+  uint64_t         state = 1;
+  auto             next  = [&state] {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return state >> 33;
+  };
+  for (size_t i = 0; i < 200; ++i) {
+    size_t pos = expected.empty() ? 0 : next() % (expected.size() + 1);
+    if (next() % 3 == 0 && !expected.empty()) {
+      size_t count = std::min<size_t>(next() % 40, expected.size() - pos);
+      array.erase(array.begin() + pos, array.begin() + pos + count);
+      expected.erase(expected.begin() + pos, expected.begin() + pos + count);
+    } else {
+      std::vector<T> values(next() % 40);
+      for (auto& value : values)
+        value = static_cast<T>(next()) & mask;
+      auto it = array.insert(array.begin() + pos, values.begin(), values.end());
+      ASSERT_EQ(it - array.begin(), pos);
+      expected.insert(expected.begin() + pos, values.begin(), values.end());
+    }
+    ASSERT_EQ(array.size(), expected.size());
+    for (size_t j = 0; j < expected.size(); ++j)
+      ASSERT_EQ(array[j], expected[j]) << "Iteration " << i << " index " << j;
+  }
+}
+
+TEST(UnitTest, InsertValue) {
+  vector<11> array{1, 2, 3};
+  array.insert(array.begin() + 1, 7u);
+  array.insert(array.end(), 2, 9u);
+  array.insert(array.begin(), {5, 6});
+  array.erase(array.begin() + 3);
+  std::vector<uint32_t> expected{5, 6, 1, 2, 3, 9, 9};
+  ASSERT_TRUE(std::ranges::equal(array, expected));
+}
+
+TEST(UnitTest, AppendRange) {
+  vector<11>            array{1, 2};
+  std::vector<uint32_t> values(100, 3);
+  array.append(values);
+  array.append(std::views::iota(0u, 5u));
+  ASSERT_EQ(array.size(), 107);
+  ASSERT_EQ(array[1], 2u);
+  ASSERT_EQ(array[101], 3u);
+  ASSERT_EQ(array[106], 4u);
+}
+
+TEST(UnitTest, AssignInputIterator) {
+  // Single pass iterators cannot be measured before packing
+  std::istringstream few("1 2 3 4 5");
+  vector<11>         array{7, 7, 7, 7, 7, 7, 7};
+  array.assign(std::istream_iterator<uint32_t>(few),
+               std::istream_iterator<uint32_t>());
+  ASSERT_EQ(array, (vector<11>{1, 2, 3, 4, 5}));
+
+  // More than one buffered block
+  std::string text;
+  for (uint32_t i = 0; i < 1000; ++i)
+    text += std::to_string(i) + " ";
+  std::istringstream many(text);
+  array.assign(std::istream_iterator<uint32_t>(many),
+               std::istream_iterator<uint32_t>());
+  ASSERT_TRUE(std::ranges::equal(array, std::views::iota(0u, 1000u)));
+
+  std::istringstream more("5 6 7");
+  array.append(std::views::istream<uint32_t>(more));
+  ASSERT_EQ(array.size(), 1003);
+  ASSERT_EQ(array[999], 999u);
+  ASSERT_EQ(array[1002], 7u);
+}
+
+TYPED_TEST(Bulk, Gather) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  for (size_t size : {3, 10000}) {
+    const vector<bits, T> array(sample_values<T>(size, bits));
+    // Include the last values, where wide loads would pass the end
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < 101; ++i)
+      indices.push_back(i * 7919 % size);
+    for (size_t i = 0; i < std::min<size_t>(size, 9); ++i)
+      indices.push_back(size - 1 - i);
+    for (size_t distance : {size_t(0), size_t(3), default_prefetch_distance}) {
+      std::vector<T> values(indices.size());
+      gather(array, indices, values, distance);
+      for (size_t i = 0; i < indices.size(); ++i)
+        ASSERT_EQ(values[i], array[indices[i]]) << "Index " << indices[i];
+    }
+  }
+}
+
+TEST(UnitTest, GatherTooSmall) {
+  // A short output is rejected before writing
+  const vector<11>      array{1, 2, 3};
+  std::vector<size_t>   indices{0, 1, 2};
+  std::vector<uint32_t> out(4, 7);
+  ASSERT_THROW(gather(array, indices, std::span(out).first(2)),
+               std::invalid_argument);
+  ASSERT_EQ(out, (std::vector<uint32_t>{7, 7, 7, 7}));
+  gather(array, indices, out);
+  ASSERT_EQ(out, (std::vector<uint32_t>{1, 2, 3, 7}));
+}
+
+TYPED_TEST(Bulk, Scatter) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  const T          mask = static_cast<T>((uint64_t(1) << bits) - 1);
+  for (size_t size : {3, 1000}) {
+    // Duplicates, neighbours that share a word and the last values
+    std::vector<size_t> indices;
+    std::vector<T>      values;
+    for (size_t i = 0; i < 301; ++i) {
+      indices.push_back(i * 7919 % size);
+      values.push_back(static_cast<T>(i * 40503u) & mask);
+    }
+    for (size_t i = 0; i < std::min<size_t>(size, 9); ++i) {
+      indices.push_back(size - 1 - i);
+      values.push_back(static_cast<T>(~i) & mask);
+    }
+    std::vector<T> expected = sample_values<T>(size, bits);
+    for (size_t i = 0; i < indices.size(); ++i)
+      expected[indices[i]] = values[i];
+    for (auto order : {scatter_order::as_given, scatter_order::by_word}) {
+      for (size_t distance : {size_t(0), default_prefetch_distance}) {
+        vector<bits, T> array(sample_values<T>(size, bits));
+        scatter(array, indices, std::span<const T>(values), order, distance);
+        ASSERT_TRUE(std::ranges::equal(array, expected)) << "Size " << size;
+      }
+    }
+  }
+}
+
+TEST(UnitTest, ScatterTooFew) {
+  // Too few values are rejected before writing
+  vector<11>            array(4);
+  std::vector<size_t>   indices{0, 1, 2};
+  std::vector<uint32_t> values{1, 2};
+  for (auto order : {scatter_order::as_given, scatter_order::by_word}) {
+    ASSERT_THROW(scatter(array, indices, std::span<const uint32_t>(values),
+                         order),
+                 std::invalid_argument);
+    ASSERT_THROW(scatter(array, indices, std::span<const uint32_t>(values),
+                         std::plus<>(), order),
+                 std::invalid_argument);
+  }
+  ASSERT_TRUE(std::ranges::all_of(array, [](uint32_t v) { return v == 0; }));
+}
+
+TEST(UnitTest, ScatterReduce) {
+  vector<20>            counters(100);
+  std::vector<size_t>   indices{5, 6, 5, 99, 5, 0};
+  std::vector<uint32_t> ones(indices.size(), 1);
+  for (auto order : {scatter_order::as_given, scatter_order::by_word})
+    scatter(counters, indices, std::span<const uint32_t>(ones), std::plus<>(),
+            order);
+  ASSERT_EQ(counters[5], 6u);
+  ASSERT_EQ(counters[6], 2u);
+  ASSERT_EQ(counters[99], 2u);
+  ASSERT_EQ(counters[0], 2u);
+  ASSERT_EQ(counters[1], 0u);
+  ASSERT_EQ(counters[4], 0u);
+}
+
+// Fills and copies sub-ranges at every offset within a word group, checking
+// that values either side are untouched
+TYPED_TEST(Bulk, WordLevel) {
+  constexpr size_t      bits = TypeParam::bits;
+  using T                    = typename TypeParam::type;
+  const T               mask = static_cast<T>((uint64_t(1) << bits) - 1);
+  const size_t          size = 500;
+  const vector<bits, T> source(sample_values<T>(size, bits));
+  for (size_t first = 0; first < 70; first += 3) {
+    for (size_t last : {first, first + 1, size / 2, size - first}) {
+      if (last < first)
+        continue;
+      vector<bits, T> array(source);
+      fill(array.begin() + first, array.begin() + last, mask);
+      for (size_t i = 0; i < size; ++i)
+        ASSERT_EQ(array[i], i >= first && i < last ? mask : source[i])
+            << "Fill " << first << ", " << last << " index " << i;
+
+      // Copy source[first, last) to array[to, ...) at a different offset
+      size_t to = size - last;
+      copy(source.cbegin() + first, source.cbegin() + last,
+           array.begin() + to);
+      for (size_t i = to; i < to + last - first; ++i)
+        ASSERT_EQ(array[i], source[first + i - to]) << "Copy index " << i;
+      ASSERT_TRUE(equal(source.cbegin() + first, source.cbegin() + last,
+                        array.cbegin() + to));
+      if (last - first > 0) {
+        array[to + (last - first) / 2] = ~array[to + (last - first) / 2];
+        ASSERT_FALSE(equal(source.cbegin() + first, source.cbegin() + last,
+                           array.cbegin() + to));
+      }
+    }
+  }
+}
+
+TEST(UnitTest, FillConstructAndEqual) {
+  vector<11> a(1000, 1234u);
+  ASSERT_TRUE(std::ranges::all_of(a, [](uint32_t v) { return v == 1234; }));
+  vector<11> b(a);
+  ASSERT_EQ(a, b);
+  b.insert(b.begin() + 3, 5, 7u);
+  ASSERT_NE(a, b);
+  ASSERT_EQ(b[2], 1234u);
+  ASSERT_EQ(b[7], 7u);
+  ASSERT_EQ(b[8], 1234u);
+  b.erase(b.begin() + 3, b.begin() + 8);
+  ASSERT_EQ(a, b);
+  vector<11> c(std::ranges::subrange(a.begin() + 1, a.end()));
+  ASSERT_EQ(c.size(), 999);
+  ASSERT_EQ(c[998], 1234u);
+}
+
+TYPED_TEST(Bulk, Transcode) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  for (size_t size : {3, 1000}) {
+    // Values fit the narrowest destination
+    const vector<bits, T> in(sample_values<T>(size, std::min<size_t>(bits, 9)));
+    auto check = [&](const auto& out) {
+      ASSERT_EQ(out.size(), size);
+      for (size_t i = 0; i < size; ++i)
+        ASSERT_EQ(uint64_t(out[i]), uint64_t(in[i])) << "Index " << i;
+    };
+    check(transcode<9, uint16_t>(in));
+    check(transcode<bits, T>(in));
+    check(transcode<bits, uint64_t>(in));
+    check(transcode<40, uint64_t>(in));
+  }
+}
+
+TEST(UnitTest, Transcode) {
+  // Narrowing a value that does not fit
+  vector<16> wide{1, 2, 2047, 2048, 3};
+  ASSERT_THROW(transcode<11>(wide), std::out_of_range);
+  vector<11> low = transcode<11>(wide, narrowing::unchecked);
+  ASSERT_EQ(low[2], 2047u);
+  ASSERT_EQ(low[3], 0u);
+  ASSERT_EQ(low[4], 3u);
+
+  // Into part of an existing span
+  std::vector<uint64_t> words(10);
+  span<33, uint64_t>    view(words, 5);
+  transcode(vector<11>{4, 5, 6}, view);
+  ASSERT_EQ(view[2], 6u);
+
+  // A destination smaller than the input is rejected before writing
+  vector<13> small(2);
+  ASSERT_THROW(transcode(vector<11>{4, 5, 6}, small), std::invalid_argument);
+  ASSERT_EQ(small[0], 0u);
+}
+
+TYPED_TEST(Bulk, Reductions) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  for (size_t size : {5, 1001}) {
+    const std::vector<T>  values = sample_values<T>(size, bits);
+    const vector<bits, T> array(values);
+    uint64_t              expected = 0;
+    for (T value : values)
+      expected += value;
+    ASSERT_EQ(sum(array), expected);
+    auto [lo, hi] = std::ranges::minmax(values);
+    ASSERT_EQ(min_max(array).min, lo);
+    ASSERT_EQ(min_max(array).max, hi);
+    ASSERT_EQ(count(array, values[size / 2]),
+              std::ranges::count(values, values[size / 2]));
+    // Checking every bucket of wider histograms is slow
+    if constexpr (bits <= 13) {
+      std::vector<size_t> counts(size_t(1) << bits, 1);
+      histogram(array, counts);
+      for (size_t value = 0; value < counts.size(); ++value)
+        ASSERT_EQ(counts[value],
+                  1 + std::ranges::count(values, static_cast<T>(value)))
+            << "Value " << value;
+    }
+  }
+}
+
+TEST(UnitTest, Reductions) {
+  vector<1> bits{1, 0, 1, 1};
+  ASSERT_EQ(count(bits, 1u), 3);
+  ASSERT_EQ(count(bits, 0u), 1);
+  ASSERT_EQ(count(bits, 2u), 0);
+  ASSERT_THROW(min_max(vector<11>()), std::invalid_argument);
+  std::vector<size_t> too_few(100);
+  ASSERT_THROW(histogram(vector<11>(5), too_few), std::invalid_argument);
+}
+
+TYPED_TEST(Bulk, Padded) {
+  constexpr size_t bits = TypeParam::bits;
+  using T               = typename TypeParam::type;
+  // Padded storage loads a whole 64-bit word per value
+  if constexpr (bits <= 56) {
+    const size_t           size   = 1001;
+    const std::vector<T>   values = sample_values<T>(size, bits);
+    vector<bits, T>        plain(size);
+    padded_vector<bits, T> padded(size);
+    ASSERT_GE(padded.size_bytes(), plain.size_bytes() + 8);
+    for (size_t i = 0; i < size; ++i) {
+      size_t index  = i * 7919 % size;
+      plain[index]  = values[i];
+      padded[index] = values[i];
+      ASSERT_EQ(padded[index], values[i]);
+    }
+    ASSERT_TRUE(std::ranges::equal(plain, padded));
+    ASSERT_EQ(sum(padded), sum(plain));
+
+    // Shrinking clears the old words, so growing reads zeros
+    padded.resize(size / 2);
+    padded.resize(size);
+    for (size_t i = 0; i < size; ++i)
+      ASSERT_EQ(padded[i], i < size / 2 ? static_cast<T>(plain[i]) : T(0));
+
+    padded.insert(padded.begin() + 1, 3, T(1));
+    padded.erase(padded.begin() + 1, padded.begin() + 4);
+    padded_span<bits, const T> view(padded);
+    span<bits, const T>        plain_view(padded);
+    ASSERT_EQ(view.size(), size);
+    ASSERT_EQ(view[size / 2 - 1], plain_view[size / 2 - 1]);
+    const T mask = static_cast<T>((uint64_t(1) << bits) - 1);
+    padded.push_back(mask);
+    ASSERT_EQ(padded.back(), mask);
+  }
+}
+
+TEST(UnitTest, Padded) {
+  static_assert(std::is_constructible_v<span<11, uint32_t>,
+                                        padded_vector<11, uint32_t>&>);
+  // Words that include the padding would be read as values
+  static_assert(!std::is_constructible_v<padded_span<11, uint32_t>,
+                                         std::vector<uint32_t>&>);
+  static_assert(std::is_constructible_v<padded_span<11, uint32_t>,
+                                        std::span<uint32_t>, size_t>);
+}
+
+TEST(UnitTest, IteratorCompare) {
+  vector<11> array(100);
+  auto       first = array.begin() + 10;
+  auto       last  = array.begin() + 20;
+  ASSERT_TRUE(first < last);
+  ASSERT_TRUE(first <= last);
+  ASSERT_FALSE(first > last);
+  ASSERT_FALSE(first >= last);
+  ASSERT_TRUE(last > first);
+  ASSERT_TRUE(first <= first && first >= first);
+
+  // The same position reached by stepping back compares equal
+  auto back = array.begin() + 3;
+  --back;
+  ASSERT_TRUE(back == array.begin() + 2);
+  ASSERT_FALSE(back < array.begin() + 2);
+}
+
+TYPED_TEST(Bulk, ValueIterator) {
+  constexpr size_t bits     = TypeParam::bits;
+  using T                   = typename TypeParam::type;
+  const size_t     size     = 1000;
+  std::vector<T>   expected = sample_values<T>(size, bits);
+  vector<bits, T>  array(expected);
+  auto             view     = values(array);
+  ASSERT_EQ(std::ranges::distance(view), ptrdiff_t(size));
+  ASSERT_TRUE(std::ranges::equal(view, expected));
+  ASSERT_EQ(std::accumulate(view.begin(), view.end(), uint64_t(0)),
+            std::accumulate(expected.begin(), expected.end(), uint64_t(0)));
+
+  std::ranges::sort(expected);
+  array.assign(expected.begin(), expected.end());
+  view  = values(array);
+  T key = expected[size / 3];
+  ASSERT_EQ(std::ranges::lower_bound(view, key) - view.begin(),
+            std::ranges::lower_bound(expected, key) - expected.begin());
+  ASSERT_EQ(view.begin()[size / 2], expected[size / 2]);
+  ASSERT_EQ(*(view.end() - 1), expected.back());
+}
+
+TEST(UnitTest, ValueIterator) {
+  using iterator = const_value_iterator<11, uint32_t>;
+  static_assert(std::random_access_iterator<iterator>);
+  static_assert(
+      std::ranges::random_access_range<decltype(values(vector<11>()))>);
+  static_assert(std::is_same_v<std::iter_reference_t<iterator>, uint32_t>);
+
+  constexpr array<11, 4> table{1, 2, 3, 2047};
+  static_assert(values(table).begin()[3] == 2047);
+
+  std::vector<uint32_t> words(10, ~0u);
+  span<5, uint32_t>     view(words, 7);
+  ASSERT_EQ(std::ranges::count(values(view), 31u), 7);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,86 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <execution>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <ranges>
+#include <tight_uint/parallel.hpp>
+#include "test_values.h"
+
+using namespace tight_uint;
+
+static_assert(chunk_alignment<11, uint32_t> == 32);
+static_assert(chunk_alignment<13, uint64_t> == 64);
+static_assert(chunk_alignment<8, uint32_t> == 4);
+
+TEST(Parallel, ChunkBoundaries) {
+  vector<11> array(std::views::iota(0u, 1000u));
+  auto       parts = chunks(array, 7);
+  size_t     total = 0;
+  for (auto& part : parts) {
+    // Every chunk starts on a word boundary and the values line up
+    ASSERT_EQ((total % chunk_alignment<11, uint32_t>), 0);
+    ASSERT_EQ((part.data() - array.data()) * 8, total * 11);
+    for (size_t i = 0; i < part.size(); ++i)
+      ASSERT_EQ(part[i], (total + i) & 2047u) << "Index " << total + i;
+    total += part.size();
+  }
+  ASSERT_LE(parts.size(), 7);
+  ASSERT_EQ(total, array.size());
+}
+
+TEST(Parallel, ChunkSmall) {
+  vector<11> array(5, 3u);
+  auto       parts = chunks(array, 8);
+  ASSERT_EQ(parts.size(), 1);
+  ASSERT_EQ(parts[0].size(), 5);
+  ASSERT_TRUE(chunks(vector<11>(), 8).empty());
+
+  // Zero chunks asks for one
+  vector<11> large(100000);
+  auto       whole = chunks(large, 0);
+  ASSERT_EQ(whole.size(), 1);
+  ASSERT_EQ(whole[0].size(), large.size());
+}
+
+TEST(Parallel, Fill) {
+  vector<11> array(100003);
+  parallel::fill(std::execution::par, array, 1234u);
+  for (size_t i = 0; i < array.size(); ++i)
+    ASSERT_EQ(array[i], 1234u) << "Index " << i;
+}
+
+TEST(Parallel, ForEach) {
+  vector<13> array(100003, 1u);
+  parallel::for_each(std::execution::par, array,
+                     [](auto&& value) { value = value + 2u; });
+  for (size_t i = 0; i < array.size(); ++i)
+    ASSERT_EQ(array[i], 3u) << "Index " << i;
+}
+
+TEST(Parallel, TransformReduce) {
+  const vector<11> in(std::views::iota(0u, 100003u));
+  vector<13>       out(in.size());
+  parallel::transform(std::execution::par, in, out,
+                      [](uint32_t value) { return value * 2u; });
+  for (size_t i = 0; i < out.size(); ++i)
+    ASSERT_EQ(out[i], (i & 2047u) * 2u) << "Index " << i;
+  uint64_t expected = std::accumulate(out.begin(), out.end(), uint64_t(0));
+  ASSERT_EQ(parallel::reduce(std::execution::par, out, uint64_t(0)), expected);
+}
+
+TEST(Parallel, Sort) {
+  vector<11> counted(sample_values<uint32_t>(300007, 11));
+  vector<21> radix(sample_values<uint32_t>(300007, 21));
+  std::vector<uint32_t> expected(radix.begin(), radix.end());
+  std::sort(expected.begin(), expected.end());
+  uint64_t total = std::accumulate(counted.begin(), counted.end(), uint64_t(0));
+  parallel::sort(std::execution::par, counted);
+  parallel::sort(std::execution::par, radix);
+  ASSERT_TRUE(std::ranges::is_sorted(counted));
+  ASSERT_EQ(std::accumulate(counted.begin(), counted.end(), uint64_t(0)),
+            total);
+  ASSERT_TRUE(std::ranges::equal(radix, expected));
+  ASSERT_EQ(counted[0], 0u);
+  ASSERT_EQ(counted[counted.size() - 1], 2047u);
+}
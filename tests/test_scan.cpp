@@ -0,0 +1,105 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <gtest/gtest.h>
+#include <tight_uint/scan.hpp>
+#include <vector>
+#include "test_values.h"
+
+using namespace tight_uint;
+
+namespace {
+
+template <size_t bits, class T>
+void testScan(size_t size, size_t offset) {
+  const T              max_value = static_cast<T>((uint64_t(1) << bits) - 1);
+  const std::vector<T> values    = sample_values<T>(size, bits);
+  vector<bits, T>      array(values);
+
+  std::vector<std::pair<T, T>> bounds = {
+      {0, 0}, {max_value, max_value}, {0, max_value}, {1, 0},
+      {static_cast<T>(max_value / 3), static_cast<T>(max_value / 2)}};
+  for (auto [lo, hi] : bounds) {
+    // Bits past the range are kept
+    vector<1, uint64_t> bitmap(size + 3, 1u);
+    std::vector<size_t> indices;
+    size_t              bitmap_matches, index_matches;
+    if (offset == 0) {
+      bitmap_matches = scan_between(array, lo, hi, bitmap);
+      index_matches  = scan_between(array, lo, hi, indices);
+    } else if (lo <= hi) {
+      bitmap_matches = detail::scan_bits<bits>(
+          std::to_address(array.begin().base()), offset * bits,
+          size - offset, lo, hi, std::to_address(bitmap.begin().base()));
+      index_matches = bitmap_matches;
+      for (size_t i = 0; i < size - offset; ++i)
+        if (bitmap[i])
+          indices.push_back(i);
+    } else {
+      continue;
+    }
+    std::vector<size_t> expected;
+    for (size_t i = offset; i < size; ++i)
+      if (lo <= values[i] && values[i] <= hi)
+        expected.push_back(i - offset);
+    EXPECT_EQ(bitmap_matches, expected.size());
+    EXPECT_EQ(index_matches, expected.size());
+    EXPECT_EQ(indices, expected);
+    for (size_t i = 0, j = 0; i < size - offset; ++i) {
+      bool selected = j < expected.size() && expected[j] == i;
+      j += selected;
+      ASSERT_EQ(bitmap[i], selected ? 1u : 0u) << bits << " bits, i " << i;
+    }
+    for (size_t i = size - offset; i < bitmap.size(); ++i)
+      ASSERT_EQ(bitmap[i], 1u);
+  }
+}
+
+template <size_t bits, class T>
+void testScan() {
+  for (size_t size : {0, 1, 63, 64, 65, 300, 5000})
+    for (size_t offset : {0, 1, 37})
+      if (offset <= size)
+        testScan<bits, T>(size, offset);
+}
+
+} // namespace
+
+TEST(Scan, Between) {
+  testScan<1, uint8_t>();
+  testScan<1, uint64_t>();
+  testScan<2, uint16_t>();
+  testScan<2, uint32_t>();
+  testScan<3, uint32_t>();
+  testScan<4, uint8_t>();
+  testScan<4, uint64_t>();
+  testScan<7, uint32_t>();
+  testScan<8, uint32_t>();
+  testScan<11, uint32_t>();
+  testScan<16, uint64_t>();
+  testScan<31, uint32_t>();
+  testScan<32, uint64_t>();
+  testScan<47, uint64_t>();
+}
+
+TEST(Scan, EqLt) {
+  std::vector<uint32_t> values = {3, 0, 5, 3, 7, 1, 3, 6};
+  vector<3>             array(values);
+  std::vector<size_t>   indices;
+  EXPECT_EQ(scan_eq(array, 3u, indices), 3u);
+  EXPECT_EQ(indices, (std::vector<size_t>{0, 3, 6}));
+  indices.clear();
+  EXPECT_EQ(scan_lt(array, 3u, indices), 2u);
+  EXPECT_EQ(indices, (std::vector<size_t>{1, 5}));
+  indices.clear();
+  EXPECT_EQ(scan_lt(array, 0u, indices), 0u);
+  EXPECT_EQ(scan_eq(array, 8u, indices), 0u);
+  EXPECT_EQ(scan_lt(array, 100u, indices), values.size());
+
+  vector<1, uint64_t> bitmap(values.size());
+  EXPECT_EQ(scan_eq(array, 7u, bitmap), 1u);
+  EXPECT_EQ(bitmap[4], 1u);
+  EXPECT_EQ(scan_lt(array, 7u, bitmap), 7u);
+  EXPECT_EQ(bitmap[4], 0u);
+  vector<1, uint64_t> small(3);
+  EXPECT_THROW(scan_eq(array, 7u, small), std::invalid_argument);
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <ranges>
+#include <tight_uint/search.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+namespace {
+
+// Sorted values with duplicates and gaps
+template <class T>
+std::vector<T> make_sorted(size_t size, T max_value) {
+  std::vector<T> result(size);
+  for (size_t i = 0; i < size; ++i)
+    result[i] = static_cast<T>(i * 7 / 3 % (uint64_t(max_value) + 1));
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+template <size_t bits, class T, size_t block_size = 64>
+void testSearch(size_t size) {
+  T max_value = static_cast<T>((uint64_t(1) << bits) - 1);
+  std::vector<T>                    values = make_sorted<T>(size, max_value);
+  vector<bits, T>                   array(values);
+  sorted_index<bits, T, block_size> index(array);
+  std::vector<T>                    keys;
+  for (uint64_t key = 0; key < uint64_t(size) * 3 && key <= max_value;
+       key += 1 + key / 50)
+    keys.push_back(static_cast<T>(key));
+  keys.push_back(max_value);
+
+  std::vector<size_t> lower(keys.size());
+  std::vector<size_t> upper(keys.size());
+  index.lower_bound(keys, lower);
+  index.upper_bound(keys, upper, 0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    T      key      = keys[i];
+    size_t expected = std::lower_bound(values.begin(), values.end(), key) -
+                      values.begin();
+    ASSERT_EQ(index.lower_bound(key), expected) << "Key " << uint64_t(key);
+    ASSERT_EQ(lower[i], expected) << "Key " << uint64_t(key);
+    expected =
+        std::upper_bound(values.begin(), values.end(), key) - values.begin();
+    ASSERT_EQ(index.upper_bound(key), expected) << "Key " << uint64_t(key);
+    ASSERT_EQ(upper[i], expected) << "Key " << uint64_t(key);
+    ASSERT_EQ(index.contains(key),
+              std::binary_search(values.begin(), values.end(), key));
+  }
+}
+
+} // namespace
+
+TEST(SortedIndex, Search) {
+  testSearch<20, uint32_t>(10000);
+  testSearch<20, uint32_t>(10001);
+  testSearch<11, uint32_t>(5000);
+  testSearch<13, uint32_t, 32>(1000);
+  testSearch<7, uint8_t>(300);
+  testSearch<40, uint64_t>(3000);
+  testSearch<20, uint32_t>(1);
+}
+
+TEST(SortedIndex, Empty) {
+  vector<20>       array;
+  sorted_index<20> index(array);
+  ASSERT_EQ(index.lower_bound(5), 0);
+  ASSERT_EQ(index.upper_bound(5), 0);
+  ASSERT_FALSE(index.contains(5));
+}
+
+TEST(SortedIndex, Samples) {
+  vector<20>       array(std::views::iota(0u, 1000u));
+  sorted_index<20> index(array);
+  ASSERT_EQ(index.samples().size(), 16);
+  ASSERT_EQ(index.samples()[1], 64u);
+  ASSERT_EQ(index.lower_bound(500), 500);
+  ASSERT_EQ(index.upper_bound(500), 501);
+}
+
+TEST(SortedIndex, OutputTooSmall) {
+  // A short output is rejected before writing
+  vector<20>            array(std::views::iota(0u, 1000u));
+  sorted_index<20>      index(array);
+  std::vector<uint32_t> keys(64, 500);
+  std::vector<size_t>   out(4, 7);
+  ASSERT_THROW(index.lower_bound(keys, out), std::invalid_argument);
+  ASSERT_THROW(index.upper_bound(keys, out), std::invalid_argument);
+  ASSERT_EQ(out, (std::vector<size_t>{7, 7, 7, 7}));
+}
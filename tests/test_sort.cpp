@@ -0,0 +1,68 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <tight_uint/sort.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+static_assert(detail::radix_passes<13> == 2);
+static_assert(detail::radix_digit_bits<13> == 7);
+static_assert(detail::radix_passes<63> == 6);
+
+namespace {
+
+// Sorts pseudo random values and compares with std::sort of the same values
+template <size_t bits, class T>
+void testSort(size_t size, uint64_t max_value) {
+  std::vector<T> values(size);
+  uint64_t       state = 12345;
+  for (auto& value : values) {
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    value = static_cast<T>((state >> 11) % (max_value + 1));
+  }
+  vector<bits, T> array(values);
+  sort(array);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(array.size(), size);
+  for (size_t i = 0; i < size; ++i)
+    ASSERT_EQ(array[i], values[i]) << "Index " << i;
+}
+
+} // namespace
+
+TEST(Sort, Counting) {
+  testSort<1, uint32_t>(1000, 1);
+  testSort<5, uint8_t>(1000, 31);
+  testSort<11, uint32_t>(5000, 2047);
+  testSort<16, uint64_t>(100000, 65535);
+  testSort<11, uint32_t>(5000, 3); // mostly empty runs
+}
+
+TEST(Sort, Radix) {
+  testSort<13, uint32_t>(5000, 8191);
+  testSort<13, uint32_t>(5000, 100); // skips the high digit pass
+  testSort<16, uint32_t>(5000, 65535);
+  testSort<24, uint32_t>(100000, (1u << 24) - 1);
+  testSort<31, uint32_t>(10000, (1u << 31) - 1);
+  testSort<40, uint64_t>(10000, (uint64_t(1) << 40) - 1);
+  testSort<63, uint64_t>(10000, (uint64_t(1) << 63) - 1);
+}
+
+TEST(Sort, Small) {
+  testSort<20, uint32_t>(0, 0);
+  testSort<20, uint32_t>(1, 100);
+  testSort<20, uint32_t>(100, (1u << 20) - 1);
+}
+
+TEST(Sort, Span) {
+  std::vector<uint32_t> words(100);
+  span<17, uint32_t>    view(words, 150);
+  for (size_t i = 0; i < view.size(); ++i)
+    view[i] = static_cast<uint32_t>(150 - i);
+  stable_sort(view);
+  ASSERT_TRUE(std::ranges::is_sorted(view));
+  ASSERT_EQ(view[0], 1u);
+  ASSERT_EQ(view[149], 150u);
+}
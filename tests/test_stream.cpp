@@ -0,0 +1,145 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <span>
+#include <sstream>
+#include <tight_uint/stream.hpp>
+#include <tight_uint/tight_uint.hpp>
+#include <vector>
+
+using namespace tight_uint;
+
+namespace {
+
+template <size_t bits, class T>
+std::vector<T> random_values(size_t size) {
+  std::mt19937_64                  rng(bits);
+  std::uniform_int_distribution<T> dist(0, (T(1) << bits) - 1);
+  std::vector<T>                   result(size);
+  std::ranges::generate(result, [&] { return dist(rng); });
+  return result;
+}
+
+// Fails every write, which a stream with exceptions() enabled throws for
+struct failing_buf : std::streambuf {
+  int overflow(int) override { return traits_type::eof(); }
+};
+
+// Small buffers so values straddle many buffer boundaries
+template <size_t bits, class T>
+void test_round_trip(size_t size, size_t buffer_words) {
+  std::vector<T>    values = random_values<bits, T>(size);
+  std::stringstream stream;
+  {
+    stream_writer<bits, T> writer(stream, buffer_words);
+    writer.write(std::span(values).first(size / 3));
+    for (size_t i = size / 3; i < size / 2; ++i)
+      writer.push_back(values[i]);
+    writer.write(std::span(values).subspan(size / 2));
+    ASSERT_EQ(writer.size(), size);
+  }
+
+  // Same bytes as a vector
+  vector<bits, T> expected(values);
+  std::string     data = stream.str();
+  ASSERT_EQ(data.size(), expected.size_bytes());
+  // Not memcmp, which must not be passed the null data() of an empty vector
+  ASSERT_TRUE(std::ranges::equal(
+      std::span(reinterpret_cast<const uint8_t*>(data.data()), data.size()),
+      std::span(expected.data(), expected.size_bytes())));
+
+  stream_reader<bits, T> reader(stream, size, buffer_words);
+  std::vector<T>         result(size);
+  size_t                 first = std::min<size_t>(size, 5);
+  for (size_t i = 0; i < first; ++i)
+    result[i] = reader.read();
+  ASSERT_EQ(reader.read(std::span(result).subspan(first)), size - first);
+  ASSERT_EQ(reader.remaining(), 0);
+  ASSERT_EQ(result, values);
+}
+
+} // namespace
+
+TEST(Stream, RoundTrip) {
+  test_round_trip<11, uint32_t>(1000, 3);
+  test_round_trip<11, uint32_t>(10000, default_stream_buffer_words);
+  test_round_trip<3, uint8_t>(999, 1);
+  test_round_trip<7, uint8_t>(1001, 2);
+  test_round_trip<33, uint64_t>(500, 5);
+  test_round_trip<31, uint32_t>(777, 2);
+  test_round_trip<5, uint16_t>(0, 4);
+}
+
+TEST(Stream, Truncated) {
+  std::vector<uint32_t> values(100, 7);
+  std::stringstream     stream;
+  {
+    stream_writer<11> writer(stream);
+    writer.write(values);
+  }
+  std::string           data = stream.str();
+  std::stringstream     truncated(data.substr(0, data.size() - 4));
+  stream_reader<11>     reader(truncated, values.size());
+  std::vector<uint32_t> result(values.size());
+  ASSERT_THROW(reader.read(result), std::runtime_error);
+
+  std::stringstream whole(data);
+  stream_reader<11> whole_reader(whole, 1);
+  ASSERT_EQ(whole_reader.read(), 7u);
+  ASSERT_THROW(whole_reader.read(), std::out_of_range);
+}
+
+TEST(Stream, WriteError) {
+  failing_buf  buf;
+  std::ostream out(&buf);
+  out.exceptions(std::ios::badbit);
+  {
+    stream_writer<11> writer(out);
+    writer.push_back(7);
+    ASSERT_THROW(writer.finish(), std::ios_base::failure);
+  }
+
+  // The destructor must not throw, including while unwinding
+  out.clear();
+  ASSERT_THROW(
+      {
+        stream_writer<11> writer(out, 1);
+        writer.write(std::vector<uint32_t>(100, 7));
+      },
+      std::ios_base::failure);
+  out.clear();
+  {
+    stream_writer<11> writer(out);
+    writer.push_back(7);
+  }
+
+  // Failures are reported without stream exceptions enabled too
+  out.exceptions(std::ios::goodbit);
+  out.clear();
+  {
+    stream_writer<11> writer(out);
+    writer.push_back(7);
+    ASSERT_THROW(writer.finish(), std::runtime_error);
+  }
+  out.clear();
+  {
+    stream_writer<11> writer(out, 1);
+    ASSERT_THROW(writer.write(std::vector<uint32_t>(100, 7)),
+                 std::runtime_error);
+  }
+}
+
+TEST(Stream, WriteAfterFinish) {
+  std::stringstream stream;
+  stream_writer<11> writer(stream);
+  writer.push_back(7);
+  writer.finish();
+  std::string data = stream.str();
+  ASSERT_THROW(writer.write(std::vector<uint32_t>(100000, 7)),
+               std::logic_error);
+  ASSERT_THROW(writer.push_back(7), std::logic_error);
+  ASSERT_EQ(writer.size(), 1);
+  ASSERT_EQ(stream.str(), data);
+}
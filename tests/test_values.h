@@ -0,0 +1,37 @@
+// Copyright (c) 2023 Pyarelal Knowles, MIT License
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <vector>
+
+// An element width and word type for typed tests
+template <size_t Bits, class T>
+struct width {
+  static constexpr size_t bits = Bits;
+  using type                   = T;
+};
+
+// Widths the bulk tests run with: single bits, narrow words, values that
+// divide a word, values that straddle words and the widest below a word
+using bulk_widths =
+    testing::Types<width<1, uint32_t>, width<2, uint64_t>, width<3, uint8_t>,
+                   width<5, uint32_t>, width<7, uint8_t>, width<11, uint32_t>,
+                   width<13, uint16_t>, width<13, uint32_t>,
+                   width<16, uint32_t>, width<25, uint32_t>,
+                   width<31, uint32_t>, width<33, uint64_t>,
+                   width<57, uint64_t>, width<63, uint64_t>>;
+
+// Deterministic values spread over every bit, truncated to fit in `bits`. The
+// 64-bit golden ratio multiplier sets the high bits of wide values even for
+// small indices.
+template <class T>
+std::vector<T> sample_values(size_t size, size_t bits) {
+  const uint64_t mask = bits < 64 ? (uint64_t(1) << bits) - 1 : ~uint64_t(0);
+  std::vector<T> result(size);
+  for (size_t i = 0; i < size; ++i)
+    result[i] = static_cast<T>((i * 0x9E3779B97F4A7C15ull) & mask);
+  return result;
+}